@@ -0,0 +1,582 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+//
+// Scaling benchmark of mip6d under DCE.
+//
+// Sweeps the number of mobile nodes (CMIP6), or of mobile routers and
+// mobile network nodes per router (NEMO), and the handover rate, over
+// scenarios built by MobilityTopologyHelper. Each point runs in a child
+// process of its own, in a private directory, so that its peak RSS and
+// wall time are its own. Per point the benchmark reports:
+//  - wall time and peak RSS of the child
+//  - simulator events processed and DCE processes spawned
+//  - registration latency (mip6d start to first accepted BA) and the time
+//    every mobile was registered, -1 if some never did
+//  - handover count and latency (L2 attach to first tunneled packet)
+//  - mean ping6 delay to and from the CN, and the packets and bytes the
+//    HA tunneled (received and sent), to compare triangular routing with
+//    route optimization (--ro=0,1, cmip6 only: the CN then runs mip6d too)
+//
+// A point whose echo requests or replies never arrived has no delay to
+// report: it fails with status 2, and so does the benchmark.
+//
+// ./waf --run "dce-umip-bench --modes=cmip6,nemo --mn=1,4,16 --mr=1,4 --mnn=1,4
+//              --handover=0,0.1 --format=json --output=bench.json"
+// ./waf --run "dce-umip-bench --modes=cmip6 --mn=1,4 --ro=0,1"
+//
+
+#include "ns3/network-module.h"
+#include "ns3/core-module.h"
+#include "ns3/dce-module.h"
+#include "ns3/mip6d-helper.h"
+#include "ns3/kernel-config-helper.h"
+#include "ns3/setup-sequencer.h"
+#include "ns3/mobility-topology-helper.h"
+#include "ns3/mobility-traffic-probe.h"
+#include "ns3/mobility-module.h"
+#include "ns3/quagga-helper.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <limits.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace ns3;
+
+struct BenchPoint
+{
+  std::string mode;
+  uint32_t nMn;
+  uint32_t nMr;
+  uint32_t nMnn;
+  // handovers per second and per mobile
+  double handoverRate;
+  bool routeOptimization;
+};
+
+// written by the child through a pipe, hence plain data only
+struct BenchResult
+{
+  // 0, 2 if a delay had no sample, else the exit status of the child
+  int status;
+  double wallSeconds;
+  long maxRssKb;
+  uint64_t events;
+  uint32_t processes;
+  uint32_t mobiles;
+  uint32_t registered;
+  double registrationMean;
+  double registrationMax;
+  double convergence;
+  uint32_t handovers;
+  double handoverMean;
+  double handoverMax;
+  double delayToCn;
+  double delayFromCn;
+  uint64_t haTunneledPackets;
+  uint64_t haTunneledBytes;
+};
+
+static std::map<uint32_t, Time> g_registered;
+static Time g_mip6dStart;
+
+static void
+StepDone (std::string name, Time took)
+{
+  if (name == "bring-up")
+    {
+      // mip6d starts right away
+      g_mip6dStart = Simulator::Now ();
+    }
+}
+
+static void
+BindingAck (Ptr<Node> node, uint8_t status, uint16_t sequence)
+{
+  if (status < 128 && g_registered.find (node->GetId ()) == g_registered.end ())
+    {
+      g_registered[node->GetId ()] = Simulator::Now ();
+    }
+}
+
+static ApplicationContainer
+StartPings (NodeContainer nodes, std::string target)
+{
+  DceApplicationHelper dce;
+  dce.SetBinary ("ping6");
+  dce.SetStackSize (1 << 16);
+  dce.ResetArguments ();
+  dce.ResetEnvironment ();
+  dce.AddArgument (target);
+  return dce.Install (nodes);
+}
+
+static std::string
+Uniform (double max)
+{
+  std::ostringstream os;
+  os << "ns3::UniformRandomVariable[Min=0.0|Max=" << max << "]";
+  return os.str ();
+}
+
+static void
+RunPoint (const BenchPoint &point, uint32_t nAr, double spacing, double duration,
+          BenchResult &result)
+{
+  bool nemo = point.mode == "nemo";
+  MobilityTopologyHelper topology;
+  topology.SetAccessRouters (nAr, MobilityTopologyHelper::LAYOUT_LINE, spacing);
+  topology.SetMobileNodes (nemo ? 0 : point.nMn);
+  topology.SetMobileRouters (nemo ? point.nMr : 0, point.nMnn);
+  topology.Create ();
+  NodeContainer mobiles (topology.GetMobileNodes (), topology.GetMobileRouters ());
+
+  // crossing one access link takes spacing / speed
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::RandomRectanglePositionAllocator",
+                                 "X", StringValue (Uniform ((nAr - 1) * spacing)),
+                                 "Y", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+  if (point.handoverRate > 0)
+    {
+      std::ostringstream speed;
+      speed << "ns3::ConstantRandomVariable[Constant=" << point.handoverRate * spacing << "]";
+      mobility.SetMobilityModel ("ns3::RandomDirection2dMobilityModel",
+                                 "Bounds", RectangleValue (Rectangle (0, (nAr - 1) * spacing + 1, 0, 1)),
+                                 "Speed", StringValue (speed.str ()),
+                                 "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+    }
+  else
+    {
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    }
+  mobility.Install (mobiles);
+
+  DceManagerHelper dceMng;
+  dceMng.SetTaskManagerAttribute ("FiberManagerType",
+                                  EnumValue (0));
+  dceMng.SetNetworkStack ("ns3::LinuxSocketFdFactory",
+                          "Library", StringValue ("liblinux.so"));
+  dceMng.Install (topology.GetNodes ());
+
+  Ptr<SetupSequencer> setup = CreateObject<SetupSequencer> ();
+  setup->TraceConnectWithoutContext ("StepDone", MakeCallback (&StepDone));
+  uint32_t bringUp = setup->AddKernelStep ("bring-up", topology.GetKernelConfig ());
+
+  Mip6dHelper mip6d;
+  mip6d.SetStartPolicy (CreateObjectWithAttributes<Mip6dAllAtOnceStartPolicy>
+                          ("Start", TimeValue (Seconds (0))));
+  Ptr<Mip6dConvergenceMonitor> convergence = mip6d.EnableConvergenceMonitor ();
+  convergence->TraceConnectWithoutContext ("BindingAck", MakeCallback (&BindingAck));
+  mip6d.EnableHandoverTracing ();
+  Ptr<Mip6FlowMonitor> flows = mip6d.EnableFlowMonitor ();
+  NodeContainer daemonNodes = topology.ConfigureMip6d (mip6d);
+  if (point.routeOptimization)
+    {
+      mip6d.EnableRouteOptimization (topology.GetMobileNodes ());
+      mip6d.EnableCN (topology.GetCorrespondentNodes ());
+      daemonNodes.Add (topology.GetCorrespondentNodes ());
+    }
+  uint32_t daemons = setup->AddMip6dStep ("mip6d", mip6d, daemonNodes);
+  setup->After (daemons, bringUp);
+  uint32_t tunnels = setup->AddKernelStep ("tunnels", topology.GetTunnelConfig ());
+  setup->After (tunnels, daemons);
+
+  // tunneled traffic, so that handovers complete
+  std::ostringstream target;
+  target << topology.GetCorrespondentAddress (0);
+  NodeContainer pingers = nemo ? topology.GetMobileNetworkNodes () : topology.GetMobileNodes ();
+  flows->Install (topology.GetCorrespondentNodes ());
+  if (nemo)
+    {
+      flows->Install (pingers);
+    }
+  // what the HAs forward through their tunnels
+  Ptr<MobilityTrafficProbe> probe = CreateObject<MobilityTrafficProbe> ();
+  NodeContainer has = topology.GetHomeAgents ();
+  for (uint32_t i = 0; i < has.GetN (); i++)
+    {
+      probe->Watch (has.Get (i));
+    }
+  uint32_t pings = setup->AddStep ("ping6", MakeBoundCallback (&StartPings, pingers, target.str ()),
+                                   false);
+  setup->After (pings, tunnels);
+  for (uint32_t i = 0; i < mobiles.GetN (); i++)
+    {
+      setup->AddRegistrationCondition (pings, mobiles.Get (i));
+    }
+
+  QuaggaHelper quagga;
+  quagga.Install (topology.ConfigureRadvd (quagga));
+
+  setup->Start (Seconds (0.1));
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  result.events = Simulator::GetEventCount ();
+  result.processes = 0;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      for (uint32_t j = 0; j < (*i)->GetNApplications (); j++)
+        {
+          result.processes += DynamicCast<DceApplication> ((*i)->GetApplication (j)) != 0;
+        }
+    }
+
+  result.mobiles = mobiles.GetN ();
+  result.registered = g_registered.size ();
+  double sum = 0;
+  result.registrationMax = 0;
+  for (std::map<uint32_t, Time>::const_iterator i = g_registered.begin ();
+       i != g_registered.end (); ++i)
+    {
+      double latency = (i->second - g_mip6dStart).GetSeconds ();
+      sum += latency;
+      result.registrationMax = std::max (result.registrationMax, latency);
+    }
+  result.registrationMean = result.registered ? sum / result.registered : 0;
+  result.convergence = convergence->IsConverged ()
+    ? (convergence->GetConvergenceTime () - g_mip6dStart).GetSeconds () : -1;
+
+  // the first attach of each mobile is its initial registration
+  result.handovers = 0;
+  sum = 0;
+  result.handoverMax = 0;
+  for (uint32_t i = 0; i < mobiles.GetN (); i++)
+    {
+      Ptr<Mip6dHandoverTracer> tracer = mobiles.Get (i)->GetObject<Mip6dHandoverTracer> ();
+      std::vector<Mip6dHandover> handovers = tracer->GetHandovers ();
+      for (uint32_t j = 1; j < handovers.size (); j++)
+        {
+          if (handovers[j].firstTunneledData < Seconds (0))
+            {
+              continue;
+            }
+          double latency = (handovers[j].firstTunneledData - handovers[j].start).GetSeconds ();
+          result.handovers++;
+          sum += latency;
+          result.handoverMax = std::max (result.handoverMax, latency);
+        }
+    }
+  result.handoverMean = result.handovers ? sum / result.handovers : 0;
+
+  // echo requests go to the CN, replies come from it
+  Time toCn, fromCn;
+  uint32_t nToCn = 0, nFromCn = 0;
+  const Mip6FlowMonitor::FlowStatsContainer &stats = flows->GetFlowStats ();
+  for (Mip6FlowMonitor::FlowStatsContainer::const_iterator i = stats.begin ();
+       i != stats.end (); ++i)
+    {
+      Mip6FlowKey key = flows->GetFlowKey (i->first);
+      if (key.destination == topology.GetCorrespondentAddress (0))
+        {
+          toCn += i->second.delaySum;
+          nToCn += i->second.rxPackets;
+        }
+      else if (key.source == topology.GetCorrespondentAddress (0))
+        {
+          fromCn += i->second.delaySum;
+          nFromCn += i->second.rxPackets;
+        }
+    }
+  result.delayToCn = nToCn ? toCn.GetSeconds () / nToCn : -1;
+  result.delayFromCn = nFromCn ? fromCn.GetSeconds () / nFromCn : -1;
+  result.status = 0;
+  if (nToCn == 0 || nFromCn == 0)
+    {
+      std::cerr << point.mode << " point with " << mobiles.GetN () << " mobile(s)"
+                << (point.routeOptimization ? " and route optimization" : "")
+                << ": no echo " << (nToCn == 0 ? "request reached" : "reply came from")
+                << " the CN" << std::endl;
+      result.status = 2;
+    }
+  MobilityTrafficCounters tunneled = probe->GetCounters (MobilityTrafficProbe::CLASS_TUNNELED);
+  result.haTunneledPackets = tunneled.rxPackets + tunneled.txPackets;
+  result.haTunneledBytes = tunneled.rxBytes + tunneled.txBytes;
+
+  Simulator::Destroy ();
+}
+
+static void
+AbsolutizeSearchPath (const char *name, std::string base)
+{
+  const char *value = ::getenv (name);
+  if (value == 0)
+    {
+      return;
+    }
+  std::istringstream in (value);
+  std::string entry, result;
+  while (std::getline (in, entry, ':'))
+    {
+      if (!entry.empty () && entry[0] != '/')
+        {
+          entry = base + "/" + entry;
+        }
+      result += (result.empty () ? "" : ":") + entry;
+    }
+  ::setenv (name, result.c_str (), 1);
+}
+
+static int
+RemoveEntry (const char *path, const struct stat *sb, int flag, struct FTW *ftw)
+{
+  return ::remove (path);
+}
+
+// one child per point: fresh simulator, DCE loader and rusage
+static BenchResult
+ForkPoint (const BenchPoint &point, uint32_t nAr, double spacing, double duration, bool keep)
+{
+  BenchResult result;
+  std::memset (&result, 0, sizeof (result));
+  result.status = -1;
+
+  char cwd[PATH_MAX];
+  NS_ABORT_MSG_IF (::getcwd (cwd, sizeof (cwd)) == 0, "getcwd failed");
+  std::ostringstream name;
+  name << cwd << "/dce-umip-bench-" << point.mode << (point.routeOptimization ? "-ro" : "")
+       << "-XXXXXX";
+  std::string dirTemplate = name.str ();
+  std::vector<char> dir (dirTemplate.begin (), dirTemplate.end ());
+  dir.push_back ('\0');
+  NS_ABORT_MSG_IF (::mkdtemp (&dir[0]) == 0, "cannot create " << dirTemplate);
+
+  int fds[2];
+  NS_ABORT_MSG_IF (::pipe (fds) != 0, "pipe failed");
+  struct timeval start, end;
+  ::gettimeofday (&start, 0);
+  pid_t pid = ::fork ();
+  NS_ABORT_MSG_IF (pid < 0, "fork failed");
+  if (pid == 0)
+    {
+      ::close (fds[0]);
+      if (::chdir (&dir[0]) != 0)
+        {
+          ::_exit (1);
+        }
+      RunPoint (point, nAr, spacing, duration, result);
+      ssize_t written = ::write (fds[1], &result, sizeof (result));
+      ::_exit (written == sizeof (result) ? 0 : 1);
+    }
+
+  ::close (fds[1]);
+  // a child which dies early leaves status at -1
+  if (::read (fds[0], &result, sizeof (result)) != sizeof (result))
+    {
+      result.status = -1;
+    }
+  ::close (fds[0]);
+  int status;
+  struct rusage usage;
+  ::wait4 (pid, &status, 0, &usage);
+  ::gettimeofday (&end, 0);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      result.status = WIFEXITED (status) ? WEXITSTATUS (status) : -WTERMSIG (status);
+    }
+  result.wallSeconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  result.maxRssKb = usage.ru_maxrss;
+
+  if (!keep)
+    {
+      ::nftw (&dir[0], &RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+  return result;
+}
+
+static std::vector<uint32_t>
+ParseCounts (std::string list)
+{
+  std::vector<uint32_t> values;
+  std::istringstream in (list);
+  std::string entry;
+  while (std::getline (in, entry, ','))
+    {
+      values.push_back (std::atoi (entry.c_str ()));
+    }
+  return values;
+}
+
+static std::vector<double>
+ParseRates (std::string list)
+{
+  std::vector<double> values;
+  std::istringstream in (list);
+  std::string entry;
+  while (std::getline (in, entry, ','))
+    {
+      values.push_back (std::atof (entry.c_str ()));
+    }
+  return values;
+}
+
+static void
+PrintCsvHeader (std::ostream &os)
+{
+  os << "mode,mn,mr,mnn,handover_rate,ro,status,wall_s,max_rss_kb,events,dce_processes,"
+     << "mobiles,registered,registration_mean_s,registration_max_s,convergence_s,"
+     << "handovers,handover_mean_s,handover_max_s,"
+     << "delay_to_cn_s,delay_from_cn_s,ha_tunneled_packets,ha_tunneled_bytes" << std::endl;
+}
+
+static void
+PrintCsv (std::ostream &os, const BenchPoint &p, const BenchResult &r)
+{
+  os << p.mode << "," << p.nMn << "," << p.nMr << "," << p.nMnn << "," << p.handoverRate << ","
+     << p.routeOptimization << "," << r.status << "," << r.wallSeconds << "," << r.maxRssKb << "," << r.events << ","
+     << r.processes << "," << r.mobiles << "," << r.registered << ","
+     << r.registrationMean << "," << r.registrationMax << "," << r.convergence << ","
+     << r.handovers << "," << r.handoverMean << "," << r.handoverMax << ","
+     << r.delayToCn << "," << r.delayFromCn << ","
+     << r.haTunneledPackets << "," << r.haTunneledBytes << std::endl;
+}
+
+static void
+PrintJson (std::ostream &os, const BenchPoint &p, const BenchResult &r, bool first)
+{
+  os << (first ? "  " : ",\n  ")
+     << "{\"mode\": \"" << p.mode << "\", \"mn\": " << p.nMn << ", \"mr\": " << p.nMr
+     << ", \"mnn\": " << p.nMnn << ", \"handover_rate\": " << p.handoverRate
+     << ", \"ro\": " << (p.routeOptimization ? "true" : "false")
+     << ", \"status\": " << r.status << ", \"wall_s\": " << r.wallSeconds
+     << ", \"max_rss_kb\": " << r.maxRssKb << ", \"events\": " << r.events
+     << ", \"dce_processes\": " << r.processes << ", \"mobiles\": " << r.mobiles
+     << ", \"registered\": " << r.registered
+     << ", \"registration_mean_s\": " << r.registrationMean
+     << ", \"registration_max_s\": " << r.registrationMax
+     << ", \"convergence_s\": " << r.convergence
+     << ", \"handovers\": " << r.handovers << ", \"handover_mean_s\": " << r.handoverMean
+     << ", \"handover_max_s\": " << r.handoverMax
+     << ", \"delay_to_cn_s\": " << r.delayToCn
+     << ", \"delay_from_cn_s\": " << r.delayFromCn
+     << ", \"ha_tunneled_packets\": " << r.haTunneledPackets
+     << ", \"ha_tunneled_bytes\": " << r.haTunneledBytes << "}";
+}
+
+int main (int argc, char *argv[])
+{
+  std::string modes = "cmip6,nemo";
+  std::string mn = "1,4";
+  std::string mr = "1,2";
+  std::string mnn = "1,2";
+  std::string handover = "0,0.05";
+  std::string ro = "0";
+  uint32_t nAr = 4;
+  double spacing = 100.0;
+  double duration = 60.0;
+  std::string format = "csv";
+  std::string output;
+  bool keep = false;
+  CommandLine cmd;
+  cmd.AddValue ("modes", "Comma-separated modes among cmip6 and nemo", modes);
+  cmd.AddValue ("mn", "Comma-separated numbers of mobile nodes (cmip6)", mn);
+  cmd.AddValue ("mr", "Comma-separated numbers of mobile routers (nemo)", mr);
+  cmd.AddValue ("mnn", "Comma-separated numbers of nodes per mobile router (nemo)", mnn);
+  cmd.AddValue ("handover", "Comma-separated handover rates, per second and mobile", handover);
+  cmd.AddValue ("ro", "Comma-separated route optimization settings, 0 and/or 1 (cmip6)", ro);
+  cmd.AddValue ("ar", "Number of access routers", nAr);
+  cmd.AddValue ("spacing", "Distance between access routers, in meters", spacing);
+  cmd.AddValue ("duration", "Simulated time of each point, in seconds", duration);
+  cmd.AddValue ("format", "csv or json", format);
+  cmd.AddValue ("output", "Result file, standard output if empty", output);
+  cmd.AddValue ("keep", "Keep the directory of each point", keep);
+  cmd.Parse (argc, argv);
+
+  std::vector<BenchPoint> points;
+  std::vector<std::string> modeList;
+  std::istringstream in (modes);
+  std::string mode;
+  while (std::getline (in, mode, ','))
+    {
+      NS_ABORT_MSG_IF (mode != "cmip6" && mode != "nemo", "unsupported mode " << mode);
+      std::vector<double> rates = ParseRates (handover);
+      for (uint32_t r = 0; r < rates.size (); r++)
+        {
+          BenchPoint point;
+          point.mode = mode;
+          point.handoverRate = rates[r];
+          point.nMn = 0;
+          point.nMr = 0;
+          point.nMnn = 0;
+          // NEMO has no route optimization: its points run once, triangular
+          point.routeOptimization = false;
+          if (mode == "cmip6")
+            {
+              std::vector<uint32_t> counts = ParseCounts (mn);
+              std::vector<uint32_t> settings = ParseCounts (ro);
+              for (uint32_t i = 0; i < counts.size (); i++)
+                {
+                  for (uint32_t k = 0; k < settings.size (); k++)
+                    {
+                      point.nMn = counts[i];
+                      point.routeOptimization = settings[k] != 0;
+                      points.push_back (point);
+                    }
+                }
+              continue;
+            }
+          std::vector<uint32_t> routers = ParseCounts (mr);
+          std::vector<uint32_t> nodes = ParseCounts (mnn);
+          for (uint32_t i = 0; i < routers.size (); i++)
+            {
+              for (uint32_t j = 0; j < nodes.size (); j++)
+                {
+                  point.nMr = routers[i];
+                  point.nMnn = nodes[j];
+                  points.push_back (point);
+                }
+            }
+        }
+    }
+
+  char cwd[PATH_MAX];
+  NS_ABORT_MSG_IF (::getcwd (cwd, sizeof (cwd)) == 0, "getcwd failed");
+  AbsolutizeSearchPath ("DCE_PATH", cwd);
+  AbsolutizeSearchPath ("DCE_ROOT", cwd);
+
+  std::ofstream file;
+  if (!output.empty ())
+    {
+      file.open (output.c_str ());
+      NS_ABORT_MSG_IF (!file, "cannot write " << output);
+    }
+  std::ostream &os = output.empty () ? std::cout : file;
+  bool json = format == "json";
+  if (json)
+    {
+      os << "[" << std::endl;
+    }
+  else
+    {
+      PrintCsvHeader (os);
+    }
+  int status = 0;
+  for (uint32_t i = 0; i < points.size (); i++)
+    {
+      BenchResult result = ForkPoint (points[i], nAr, spacing, duration, keep);
+      if (result.status != 0)
+        {
+          status = 1;
+        }
+      if (json)
+        {
+          PrintJson (os, points[i], result, i == 0);
+        }
+      else
+        {
+          PrintCsv (os, points[i], result);
+        }
+      os.flush ();
+    }
+  if (json)
+    {
+      os << std::endl << "]" << std::endl;
+    }
+
+  return status;
+}
@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+//
+// Home agent load test: one mip6d HA, many virtual mobile nodes.
+//
+// The mobile nodes are played by a Mip6BindingUpdateGenerator on a node
+// without IP stack, which sends their Binding Updates from care-of
+// addresses in 2001:1:2:4::/64 and refreshes the bindings.
+//
+// Simulation Topology:
+//
+//         home link                  foreign link
+//   sim0 2001:1:2:3::1/64      sim1 2001:1:2:4::1/64
+//      ----------------+----+  +----------------+---------------
+//                      |  HA |                  |
+//                      +-----+            +-----------+
+//                                         | generator |
+//                                         +-----------+
+//
+// ./waf --run "dce-umip-bu-load --bindings=10000 --rate=1000"
+
+#include "ns3/network-module.h"
+#include "ns3/core-module.h"
+#include "ns3/dce-module.h"
+#include "ns3/mip6d-helper.h"
+#include "ns3/kernel-config-helper.h"
+#include "ns3/mip6-binding-update-generator.h"
+#include "ns3/csma-helper.h"
+#include <iostream>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  uint32_t bindings = 1000;
+  double rate = 100;
+  double lifetime = 60;
+  double duration = 120;
+  CommandLine cmd;
+  cmd.AddValue ("bindings", "Number of virtual mobile nodes", bindings);
+  cmd.AddValue ("rate", "Initial registrations per second", rate);
+  cmd.AddValue ("lifetime", "Requested binding lifetime in seconds", lifetime);
+  cmd.AddValue ("duration", "Simulated time in seconds", duration);
+  cmd.Parse (argc, argv);
+
+  NodeContainer ha, generator;
+  ha.Create (1);
+  generator.Create (1);
+
+  CsmaHelper csma;
+  csma.Install (ha);
+  csma.Install (NodeContainer (ha.Get (0), generator.Get (0)));
+
+  // only the HA runs a kernel; the generator talks to its device directly
+  DceManagerHelper dceMng;
+  dceMng.SetTaskManagerAttribute ("FiberManagerType",
+                                  EnumValue (0));
+  dceMng.SetNetworkStack ("ns3::LinuxSocketFdFactory",
+                          "Library", StringValue ("liblinux.so"));
+  dceMng.Install (ha);
+
+  KernelConfigHelper kernel;
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.AddAddress (ha.Get (0), "sim0", "2001:1:2:3::1/64");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
+  kernel.AddAddress (ha.Get (0), "sim1", "2001:1:2:4::1/64");
+  kernel.SetLinkUp (ha.Get (0), "sim1");
+  kernel.Install (Seconds (0.1));
+
+  Mip6dHelper mip6d;
+  mip6d.EnableHA (ha);
+  Ptr<Mip6dBindingSampler> sampler = mip6d.EnableBindingSampler ();
+  mip6d.Install (ha);
+
+  // once mip6d runs
+  Ptr<Mip6BindingUpdateGenerator> load = CreateObject<Mip6BindingUpdateGenerator> ();
+  load->SetAttribute ("HomeAgent", Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1")));
+  load->SetAttribute ("HomeAddressBase", Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1:0")));
+  load->SetAttribute ("CareOfAddressBase", Ipv6AddressValue (Ipv6Address ("2001:1:2:4::1:0")));
+  load->SetAttribute ("NBindings", UintegerValue (bindings));
+  load->SetAttribute ("Rate", DoubleValue (rate));
+  load->SetAttribute ("Lifetime", TimeValue (Seconds (lifetime)));
+  load->SetStartTime (Seconds (3.0));
+  generator.Get (0)->AddApplication (load);
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  sampler->Print (std::cout);
+  std::cout << "bindings registered " << load->GetNRegistered () << "/" << bindings
+            << " BU sent " << load->GetNBuSent ()
+            << " BA received " << load->GetNBaReceived ()
+            << " rejected " << load->GetNRejected () << std::endl;
+
+  Simulator::Destroy ();
+
+  return 0;
+}
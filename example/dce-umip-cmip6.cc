@@ -32,6 +32,9 @@
 #include "ns3/core-module.h"
 #include "ns3/dce-module.h"
 #include "ns3/mip6d-helper.h"
+#include "ns3/mip6-pcap-helper.h"
+#include "ns3/kernel-config-helper.h"
+#include "ns3/setup-sequencer.h"
 #include "ns3/csma-helper.h"
 #include "ns3/wifi-helper.h"
 #include "ns3/yans-wifi-helper.h"
@@ -42,30 +45,30 @@
 
 using namespace ns3;
 
-static void RunIp (Ptr<Node> node, Time at, std::string str)
+static ApplicationContainer
+StartPing6 (Ptr<Node> node, std::string target)
 {
-  DceApplicationHelper process;
-  ApplicationContainer apps;
-  process.SetBinary ("ip");
-  process.SetStackSize (1 << 16);
-  process.ResetArguments ();
-  process.ParseArguments (str.c_str ());
-  apps = process.Install (node);
-  apps.Start (at);
-}
-
-static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *address)
-{
-  std::ostringstream oss;
-  oss << "-f inet6 addr add " << address << " dev " << name;
-  RunIp (node, at, oss.str ());
+  DceApplicationHelper dce;
+  dce.SetBinary ("ping6");
+  dce.SetStackSize (1 << 16);
+  dce.ResetArguments ();
+  dce.ResetEnvironment ();
+  // dce.AddArgument ("-i");
+  // dce.AddArgument (interPacketInterval.GetSeconds ());
+  dce.AddArgument (target);
+  return dce.Install (node);
 }
 
 bool usePing = true;
+std::string pcap = "all";
+uint32_t snapLen = 128;
 int main (int argc, char *argv[])
 {
   CommandLine cmd;
   cmd.AddValue ("usePing", "Using Ping6 or not", usePing);
+  cmd.AddValue ("pcap", "Capture: all (full packets), mip6 (mobility signaling, "
+                "ND and tunnel headers only) or none", pcap);
+  cmd.AddValue ("snapLen", "Bytes kept per packet with --pcap=mip6", snapLen);
   cmd.Parse (argc, argv);
 
   NodeContainer mn, ha, ar;
@@ -121,7 +124,6 @@ int main (int argc, char *argv[])
   NetDeviceContainer cn_devices = csma.Install (NodeContainer (ar.Get (0), cn.Get (0)));
 
   DceManagerHelper dceMng;
-  DceApplicationHelper dce;
   // dceMng.SetLoader ("ns3::DlmLoaderFactory");
   dceMng.SetTaskManagerAttribute ("FiberManagerType",
                                           EnumValue (0));
@@ -135,71 +137,62 @@ int main (int argc, char *argv[])
   // Prefix configuration
   std::string ha_sim0 ("2001:1:2:3::1/64");
 
+  // Each step starts as soon as the previous one is done
+  Ptr<SetupSequencer> setup = CreateObject<SetupSequencer> ();
+
+  // Initial bring-up: one ip batch process per node
+  KernelConfigHelper kernel;
+
   // For HA
-  AddAddress (ha.Get (0), Seconds (0.1), "sim0", ha_sim0.c_str ());
-  RunIp (ha.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ha.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ha.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (ha.Get (0), Seconds (3.1), "addr list");
-  //  RunIp (ha.Get (0), Seconds (3.2), "-6 route add default via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  kernel.AddAddress (ha.Get (0), "sim0", ha_sim0);
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
 
   // For AR1 (the intermediate node)
-  AddAddress (ar.Get (0), Seconds (0.1), "sim0", "2001:1:2:3::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim1", "2001:1:2:4::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim2", "2001:1:2:6::2/64");
-  RunIp (ar.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (0), Seconds (0.13), "link set sim1 up");
-  RunIp (ar.Get (0), Seconds (0.14), "link set sim2 up");
-  RunIp (ar.Get (0), Seconds (0.15), "-6 route add 2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
-  RunIp (ar.Get (0), Seconds (0.15), "route show table all");
-  Ptr<LinuxSocketFdFactory> kern = ar.Get (0)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (0)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (0), "sim0", "2001:1:2:3::2/64");
+  kernel.AddAddress (ar.Get (0), "sim1", "2001:1:2:4::2/64");
+  kernel.AddAddress (ar.Get (0), "sim2", "2001:1:2:6::2/64");
+  kernel.SetLinkUp (ar.Get (0), "lo");
+  kernel.SetLinkUp (ar.Get (0), "sim0");
+  kernel.SetLinkUp (ar.Get (0), "sim1");
+  kernel.SetLinkUp (ar.Get (0), "sim2");
+  kernel.AddRoute (ar.Get (0), "2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (0), "route show table all");
 
   // For AR2 (the intermediate node)
-  AddAddress (ar.Get (1), Seconds (0.1), "sim0", "2001:1:2:3::3/64");
-  AddAddress (ar.Get (1), Seconds (0.1), "sim1", "2001:1:2:7::2/64");
-  RunIp (ar.Get (1), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (1), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (1), Seconds (0.13), "link set sim1 up");
-  RunIp (ar.Get (1), Seconds (0.15), "route show table all");
-  kern = ar.Get (1)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (1)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (1), "sim0", "2001:1:2:3::3/64");
+  kernel.AddAddress (ar.Get (1), "sim1", "2001:1:2:7::2/64");
+  kernel.SetLinkUp (ar.Get (1), "lo");
+  kernel.SetLinkUp (ar.Get (1), "sim0");
+  kernel.SetLinkUp (ar.Get (1), "sim1");
+  kernel.AddIpCommand (ar.Get (1), "route show table all");
+
+  // IPv6 forwarding on both ARs
+  kernel.AddSysctl (ar, ".net.ipv6.conf.all.forwarding", "1");
 
   // For MN
-  RunIp (mn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (mn.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (mn.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  //      RunIp (mn.Get (0), Seconds (3.1), "addr list");
+  kernel.SetLinkUp (mn.Get (0), "lo");
+  kernel.SetLinkUp (mn.Get (0), "sim0");
 
   // For CN
-  RunIp (cn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (cn.Get (0), Seconds (1.11), "link set sim0 up");
-  RunIp (cn.Get (0), Seconds (1.11), "add default via 2001:1:2:6::2");
-  AddAddress (cn.Get (0), Seconds (0.12), "sim0", "2001:1:2:6::7/64");
-
-  RunIp (ha.Get (0), Seconds (4.0), "addr list");
-  RunIp (ar.Get (0), Seconds (4.1), "addr list");
-  RunIp (ar.Get (1), Seconds (37.0), "addr list");
-  RunIp (mn.Get (0), Seconds (40.2), "addr list");
-  RunIp (ha.Get (0), Seconds (20.0), "route show table all");
-  RunIp (mn.Get (0), Seconds (50.0), "route show table all");
+  kernel.SetLinkUp (cn.Get (0), "lo");
+  kernel.AddAddress (cn.Get (0), "sim0", "2001:1:2:6::7/64");
+  kernel.SetLinkUp (cn.Get (0), "sim0");
+  kernel.AddIpCommand (cn.Get (0), "add default via 2001:1:2:6::2");
+  uint32_t bringUp = setup->AddKernelStep ("bring-up", kernel);
 
   {
-    ApplicationContainer apps;
     QuaggaHelper quagga;
     Mip6dHelper mip6d;
 
+    // daemons start as soon as the addresses are configured
+    mip6d.SetStartPolicy (CreateObjectWithAttributes<Mip6dAllAtOnceStartPolicy>
+                            ("Start", TimeValue (Seconds (0))));
+
+    mip6d.EnableHandoverTracing ();
+
     // HA
     mip6d.EnableHA (ha);
-    mip6d.Install (ha);
 
     // MN
     std::string ha_addr = ha_sim0;
@@ -207,7 +200,32 @@ int main (int argc, char *argv[])
     mip6d.AddHomeAgentAddress (mn.Get (0), Ipv6Address (ha_addr.c_str ()));
     mip6d.AddHomeAddress (mn.Get (0), Ipv6Address ("2001:1:2:3::1000"), Ipv6Prefix (64));
     mip6d.AddEgressInterface (mn.Get (0), "sim0");
-    mip6d.Install (mn);
+
+    uint32_t daemons = setup->AddMip6dStep ("mip6d", mip6d, NodeContainer (ha, mn));
+    setup->After (daemons, bringUp);
+
+    // Once mip6d has created the tunnel devices
+    KernelConfigHelper tunnels;
+    tunnels.SetLinkUp (ha.Get (0), "ip6tnl0");
+    tunnels.AddIpCommand (ha.Get (0), "addr list");
+    //  tunnels.AddRoute (ha.Get (0), "default via 2001:1:2:3::2 dev sim0");
+    tunnels.AddRoute (ha.Get (0), "2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
+    tunnels.AddRoute (ha.Get (0), "2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
+    tunnels.AddRoute (ha.Get (0), "2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+    tunnels.SetLinkUp (mn.Get (0), "ip6tnl0");
+    //      tunnels.AddIpCommand (mn.Get (0), "addr list");
+    uint32_t tunnelsUp = setup->AddKernelStep ("tunnels", tunnels);
+    setup->After (tunnelsUp, daemons);
+
+    // MNN
+    if (usePing)
+      {
+        uint32_t ping = setup->AddStep ("ping6", MakeBoundCallback (&StartPing6, mn.Get (0),
+                                                                    std::string ("2001:1:2:6::7")),
+                                        false);
+        setup->After (ping, tunnelsUp);
+        setup->AddRegistrationCondition (ping, mn.Get (0));
+      }
 
     // AR
     quagga.EnableRadvd (ar.Get (0), "sim0", "2001:1:2:3::/64");
@@ -219,30 +237,37 @@ int main (int argc, char *argv[])
     quagga.Install (ar);
   }
 
-  // MNN
-  if (usePing)
+  setup->Start (Seconds (0.1));
+
+  // Periodic dumps
+  KernelConfigHelper dump;
+  dump.AddIpCommand (ha.Get (0), "addr list");
+  dump.AddIpCommand (ar.Get (0), "addr list");
+  dump.Install (Seconds (4.0));
+  dump.AddIpCommand (ha.Get (0), "route show table all");
+  dump.Install (Seconds (20.0));
+  dump.AddIpCommand (ar.Get (1), "addr list");
+  dump.Install (Seconds (37.0));
+  dump.AddIpCommand (mn.Get (0), "addr list");
+  dump.Install (Seconds (40.2));
+  dump.AddIpCommand (mn.Get (0), "route show table all");
+  dump.Install (Seconds (50.0));
+
+  if (pcap == "all")
     {
-      // Ping6
-      uint32_t packetSize = 1024;
-      uint32_t maxPacketCount = 50000000;
-      Time interPacketInterval = Seconds (1.);
-
-      dce.SetBinary ("ping6");
-      dce.SetStackSize (1 << 16);
-      dce.ResetArguments ();
-      dce.ResetEnvironment ();
-      // dce.AddArgument ("-i");
-      // dce.AddArgument (interPacketInterval.GetSeconds ());
-      dce.AddArgument ("2001:1:2:6::7");
-      ApplicationContainer apps = dce.Install (mn.Get (0));
-      apps.Start (Seconds (50.0));
+      phy.EnablePcapAll ("dce-umip-cmip6");
+      csma.EnablePcapAll ("dce-umip-cmip6");
+    }
+  else if (pcap == "mip6")
+    {
+      Mip6PcapHelper mip6Pcap;
+      mip6Pcap.SetSnapLength (snapLen);
+      mip6Pcap.EnablePcapAll ("dce-umip-cmip6");
     }
-
-  phy.EnablePcapAll ("dce-umip-cmip6");
-  csma.EnablePcapAll ("dce-umip-cmip6");
 
   Simulator::Stop (Seconds (300.0));
   Simulator::Run ();
+  Mip6dHandoverTracer::PrintHandovers (std::cout);
   Simulator::Destroy ();
 
   return 0;
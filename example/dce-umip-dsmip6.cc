@@ -37,6 +37,8 @@
 #include "ns3/internet-module.h"
 #include "ns3/dce-module.h"
 #include "ns3/mip6d-helper.h"
+#include "ns3/mip6-pcap-helper.h"
+#include "ns3/kernel-config-helper.h"
 #include "ns3/csma-helper.h"
 #include "ns3/wifi-helper.h"
 #include "ns3/yans-wifi-helper.h"
@@ -47,30 +49,16 @@
 
 using namespace ns3;
 
-static void RunIp (Ptr<Node> node, Time at, std::string str)
-{
-  DceApplicationHelper process;
-  ApplicationContainer apps;
-  process.SetBinary ("ip");
-  process.SetStackSize (1 << 16);
-  process.ResetArguments ();
-  process.ParseArguments (str.c_str ());
-  apps = process.Install (node);
-  apps.Start (at);
-}
-
-static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *address)
-{
-  std::ostringstream oss;
-  oss << "-f inet6 addr add " << address << " dev " << name;
-  RunIp (node, at, oss.str ());
-}
-
 bool usePing = true;
+std::string pcap = "all";
+uint32_t snapLen = 128;
 int main (int argc, char *argv[])
 {
   CommandLine cmd;
   cmd.AddValue ("usePing", "Using Ping6 or not", usePing);
+  cmd.AddValue ("pcap", "Capture: all (full packets), mip6 (mobility signaling, "
+                "ND and tunnel headers only) or none", pcap);
+  cmd.AddValue ("snapLen", "Bytes kept per packet with --pcap=mip6", snapLen);
   cmd.Parse (argc, argv);
 
   NodeContainer mr, ha, ar;
@@ -160,73 +148,80 @@ int main (int argc, char *argv[])
   mnps->push_back (mnp1);
   mnps->push_back (mnp2);
 
+  // Initial bring-up: one ip batch process per node
+  KernelConfigHelper kernel;
+
   // For HA
-  AddAddress (ha.Get (0), Seconds (0.1), "sim0", ha_sim0.c_str ());
-  RunIp (ha.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ha.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ha.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (ha.Get (0), Seconds (3.1), "addr list");
-  //  RunIp (ha.Get (0), Seconds (3.2), "-6 route add default via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
-  RunIp (ha.Get (0), Seconds (4.13), "-4 addr add 192.168.10.1/24 dev sim0");
-  RunIp (ha.Get (0), Seconds (4.15), "-4 route add default via 192.168.10.2 dev sim0");
-  RunIp (ha.Get (0), Seconds (4.15), "-4 route add 192.168.2.0/24 via 192.168.10.3 dev sim0");
+  kernel.AddAddress (ha.Get (0), "sim0", ha_sim0);
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
 
   // For AR1 (the intermediate node)
-  AddAddress (ar.Get (0), Seconds (0.1), "sim0", "2001:1:2:3::2/64");
-  RunIp (ar.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (0), Seconds (0.13), "-4 addr add 192.168.1.1/24 dev sim1");
-  RunIp (ar.Get (0), Seconds (0.13), "link set sim1 up");
-  AddAddress (ar.Get (0), Seconds (0.13), "sim2", "2001:1:2:6::2/64");
-  RunIp (ar.Get (0), Seconds (0.14), "link set sim2 up");
-  RunIp (ar.Get (0), Seconds (0.15), "-6 route add 2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
-  RunIp (ar.Get (0), Seconds (0.15), "route show table all");
-  RunIp (ar.Get (0), Seconds (4.13), "-4 addr add 192.168.10.2/24 dev sim0");
-  Ptr<LinuxSocketFdFactory> kern = ar.Get (0)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (0)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (0), "sim0", "2001:1:2:3::2/64");
+  kernel.SetLinkUp (ar.Get (0), "lo");
+  kernel.SetLinkUp (ar.Get (0), "sim0");
+  kernel.AddAddress (ar.Get (0), "sim1", "192.168.1.1/24");
+  kernel.SetLinkUp (ar.Get (0), "sim1");
+  kernel.AddAddress (ar.Get (0), "sim2", "2001:1:2:6::2/64");
+  kernel.SetLinkUp (ar.Get (0), "sim2");
+  kernel.AddRoute (ar.Get (0), "2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (0), "route show table all");
 
   // For AR2 (the intermediate node)
-  AddAddress (ar.Get (1), Seconds (0.1), "sim0", "2001:1:2:3::3/64");
-  RunIp (ar.Get (1), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (1), Seconds (0.11), "link set sim0 up");
-  AddAddress (ar.Get (1), Seconds (0.12), "sim1", "2001:1:2:7::2/64");
-  RunIp (ar.Get (1), Seconds (0.13), "-4 addr add 192.168.2.1/24 dev sim1");
-  RunIp (ar.Get (1), Seconds (0.13), "link set sim1 up");
-  std::ostringstream oss;
-  oss << "-6 route add " << mnp1 << "/64 via 2001:1:2:3::1 dev sim0";
-  RunIp (ar.Get (1), Seconds (0.15), oss.str ());
-  RunIp (ar.Get (1), Seconds (0.15), "route show table all");
-  RunIp (ar.Get (1), Seconds (4.13), "-4 addr add 192.168.10.3/24 dev sim0");
-  kern = ar.Get (1)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (1)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (1), "sim0", "2001:1:2:3::3/64");
+  kernel.SetLinkUp (ar.Get (1), "lo");
+  kernel.SetLinkUp (ar.Get (1), "sim0");
+  kernel.AddAddress (ar.Get (1), "sim1", "2001:1:2:7::2/64");
+  kernel.AddAddress (ar.Get (1), "sim1", "192.168.2.1/24");
+  kernel.SetLinkUp (ar.Get (1), "sim1");
+  kernel.AddRoute (ar.Get (1), mnp1 + "/64 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (1), "route show table all");
+
+  // IPv6 forwarding on both ARs
+  kernel.AddSysctl (ar, ".net.ipv6.conf.all.forwarding", "1");
 
   // For MR
   for (uint32_t i = 0; i < mr.GetN (); i++)
     {
-      RunIp (mr.Get (i), Seconds (0.11), "link set lo up");
-      RunIp (mr.Get (i), Seconds (0.11), "link set sim0 up");
-      RunIp (mr.Get (i), Seconds (3.0), "link set ip6tnl0 up");
-      //      RunIp (mr.Get (i), Seconds (3.1), "addr list");
-      oss.str ("");
-      oss << mnps->at (i) << "/64";
-      AddAddress (mr.Get (i), Seconds (0.12), "sim1", oss.str ().c_str ());
-      RunIp (mr.Get (i), Seconds (0.13), "link set sim1 up");
+      kernel.SetLinkUp (mr.Get (i), "lo");
+      kernel.SetLinkUp (mr.Get (i), "sim0");
+      kernel.AddAddress (mr.Get (i), "sim1", mnps->at (i) + "/64");
+      kernel.SetLinkUp (mr.Get (i), "sim1");
     }
-
-  RunIp (ha.Get (0), Seconds (4.0), "addr list");
-  RunIp (ar.Get (0), Seconds (4.1), "addr list");
-  RunIp (mr.Get (0), Seconds (4.2), "addr list");
-  RunIp (ha.Get (0), Seconds (20.0), "route show table all");
-  RunIp (mr.Get (0), Seconds (20.0), "route show table all");
-  RunIp (mr.Get (0), Seconds (20.0), "xfrm state");
-  RunIp (mr.Get (0), Seconds (20.0), "xfrm policy");
+  kernel.Install (Seconds (0.1));
+
+  // Once mip6d has created the tunnel devices
+  kernel.SetLinkUp (ha.Get (0), "ip6tnl0");
+  kernel.AddIpCommand (ha.Get (0), "addr list");
+  //  kernel.AddRoute (ha.Get (0), "default via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  for (uint32_t i = 0; i < mr.GetN (); i++)
+    {
+      kernel.SetLinkUp (mr.Get (i), "ip6tnl0");
+      //      kernel.AddIpCommand (mr.Get (i), "addr list");
+    }
+  kernel.Install (Seconds (3.0));
+
+  kernel.AddIpCommand (ha.Get (0), "addr list");
+  kernel.AddIpCommand (ar.Get (0), "addr list");
+  kernel.AddIpCommand (mr.Get (0), "addr list");
+  kernel.Install (Seconds (4.0));
+
+  // IPv4 transport between HA and ARs
+  kernel.AddAddress (ha.Get (0), "sim0", "192.168.10.1/24");
+  kernel.AddRoute (ha.Get (0), "default via 192.168.10.2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "192.168.2.0/24 via 192.168.10.3 dev sim0");
+  kernel.AddAddress (ar.Get (0), "sim0", "192.168.10.2/24");
+  kernel.AddAddress (ar.Get (1), "sim0", "192.168.10.3/24");
+  kernel.Install (Seconds (4.13));
+
+  kernel.AddIpCommand (ha.Get (0), "route show table all");
+  kernel.AddIpCommand (mr.Get (0), "route show table all");
+  kernel.AddIpCommand (mr.Get (0), "xfrm state");
+  kernel.AddIpCommand (mr.Get (0), "xfrm policy");
+  kernel.Install (Seconds (20.0));
 
   {
     DceApplicationHelper process;
@@ -315,8 +310,17 @@ int main (int argc, char *argv[])
       apps.Start (Seconds (2.0));
     }
 
-  phy.EnablePcapAll ("dce-dsmip6d");
-  csma.EnablePcapAll ("dce-dsmip6d");
+  if (pcap == "all")
+    {
+      phy.EnablePcapAll ("dce-dsmip6d");
+      csma.EnablePcapAll ("dce-dsmip6d");
+    }
+  else if (pcap == "mip6")
+    {
+      Mip6PcapHelper mip6Pcap;
+      mip6Pcap.SetSnapLength (snapLen);
+      mip6Pcap.EnablePcapAll ("dce-dsmip6d");
+    }
 
   Simulator::Stop (Seconds (600.0));
   Simulator::Run ();
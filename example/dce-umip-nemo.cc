@@ -10,6 +10,8 @@
 // Simulation Topology:
 // Scenario: MR and MNN moves from under AR1 to AR2 with Care-of-Address
 //           alternation. during movement, MNN keeps ping6 to CN.
+//           With --goodput=udp|tcp, MNN also streams records to CN and
+//           each interruption is printed next to the MR handover.
 //
 //                                    +-----------+
 //                                    |    HA     |
@@ -36,6 +38,11 @@
 #include "ns3/core-module.h"
 #include "ns3/dce-module.h"
 #include "ns3/mip6d-helper.h"
+#include "ns3/mip6-pcap-helper.h"
+#include "ns3/mip6-goodput.h"
+#include "ns3/linux-stack-helper.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/kernel-config-helper.h"
 #include "ns3/csma-helper.h"
 #include "ns3/wifi-helper.h"
 #include "ns3/yans-wifi-helper.h"
@@ -47,36 +54,45 @@
 using namespace ns3;
 NS_LOG_COMPONENT_DEFINE ("DceUmipNemo");
 
-static void RunIp (Ptr<Node> node, Time at, std::string str)
-{
-  DceApplicationHelper process;
-  ApplicationContainer apps;
-  process.SetBinary ("ip");
-  process.SetStackSize (1 << 16);
-  process.ResetArguments ();
-  process.ParseArguments (str.c_str ());
-  apps = process.Install (node);
-  apps.Start (at);
-}
-
-static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *address)
-{
-  std::ostringstream oss;
-  oss << "-f inet6 addr add " << address << " dev " << name;
-  RunIp (node, at, oss.str ());
-}
-
 void
 PrintFlags (std::string key, std::string value)
 {
   NS_LOG_INFO (key << "=" << value);
 }
 
+static void
+Interrupted (Ptr<Node> mr, const Mip6Interruption &interruption)
+{
+  std::cout << "interruption " << interruption;
+  // the MR handover during which the flow stopped
+  Ptr<Mip6dHandoverTracer> tracer = mr->GetObject<Mip6dHandoverTracer> ();
+  std::vector<Mip6dHandover> handovers = tracer->GetHandovers ();
+  for (std::vector<Mip6dHandover>::reverse_iterator i = handovers.rbegin ();
+       i != handovers.rend (); ++i)
+    {
+      if (i->start <= interruption.end)
+        {
+          std::cout << " MR " << *i;
+          break;
+        }
+    }
+  std::cout << " MR x=" << mr->GetObject<MobilityModel> ()->GetPosition ().x << std::endl;
+}
+
 bool usePing = true;
+std::string goodput = "none";
+std::string pcap = "all";
+uint32_t snapLen = 128;
+bool flowMonitor = false;
 int main (int argc, char *argv[])
 {
   CommandLine cmd;
   cmd.AddValue ("usePing", "Using Ping6 or not", usePing);
+  cmd.AddValue ("pcap", "Capture: all (full packets), mip6 (mobility signaling, "
+                "ND and tunnel headers only) or none", pcap);
+  cmd.AddValue ("snapLen", "Bytes kept per packet with --pcap=mip6", snapLen);
+  cmd.AddValue ("goodput", "MNN to CN records for handover interruptions: udp, tcp or none", goodput);
+  cmd.AddValue ("flowMonitor", "Print per inner flow delay, loss and tunnel overhead", flowMonitor);
   cmd.Parse (argc, argv);
 
   NodeContainer mr, ha, ar;
@@ -154,6 +170,13 @@ int main (int argc, char *argv[])
                                   EnumValue (0));
   dceMng.SetNetworkStack ("ns3::LinuxSocketFdFactory",
                                   "Library", StringValue ("liblinux.so"));
+  if (goodput != "none")
+    {
+      // ns-3 sockets of the goodput applications over the Linux stack
+      LinuxStackHelper stack;
+      stack.Install (mnn);
+      stack.Install (cn);
+    }
   dceMng.Install (mr);
   dceMng.Install (ha);
   dceMng.Install (ar);
@@ -169,83 +192,96 @@ int main (int argc, char *argv[])
   mnps->push_back (mnp1);
   mnps->push_back (mnp2);
 
+  // Initial bring-up: one ip batch process per node
+  KernelConfigHelper kernel;
+
   // For HA
-  AddAddress (ha.Get (0), Seconds (0.1), "sim0", ha_sim0.c_str ());
-  RunIp (ha.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ha.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ha.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (ha.Get (0), Seconds (3.1), "addr list");
-  //  RunIp (ha.Get (0), Seconds (3.2), "-6 route add default via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  kernel.AddAddress (ha.Get (0), "sim0", ha_sim0);
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
 
   // For AR1 (the intermediate node)
-  AddAddress (ar.Get (0), Seconds (0.1), "sim0", "2001:1:2:3::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim1", "2001:1:2:4::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim2", "2001:1:2:6::2/64");
-  RunIp (ar.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (0), Seconds (0.13), "link set sim1 up");
-  RunIp (ar.Get (0), Seconds (0.14), "link set sim2 up");
-  RunIp (ar.Get (0), Seconds (0.15), "-6 route add 2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
-  RunIp (ar.Get (0), Seconds (0.15), "route show table all");
-  Ptr<LinuxSocketFdFactory> kern = ar.Get (0)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (0)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (0), "sim0", "2001:1:2:3::2/64");
+  kernel.AddAddress (ar.Get (0), "sim1", "2001:1:2:4::2/64");
+  kernel.AddAddress (ar.Get (0), "sim2", "2001:1:2:6::2/64");
+  kernel.SetLinkUp (ar.Get (0), "lo");
+  kernel.SetLinkUp (ar.Get (0), "sim0");
+  kernel.SetLinkUp (ar.Get (0), "sim1");
+  kernel.SetLinkUp (ar.Get (0), "sim2");
+  kernel.AddRoute (ar.Get (0), "2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (0), "route show table all");
 
   // For AR2 (the intermediate node)
-  AddAddress (ar.Get (1), Seconds (0.1), "sim0", "2001:1:2:3::3/64");
-  AddAddress (ar.Get (1), Seconds (0.1), "sim1", "2001:1:2:7::2/64");
-  RunIp (ar.Get (1), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (1), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (1), Seconds (0.13), "link set sim1 up");
-  std::ostringstream oss;
-  oss << "-6 route add " << mnp1 << "/64 via 2001:1:2:3::1 dev sim0";
-  RunIp (ar.Get (1), Seconds (0.15), oss.str ());
-  RunIp (ar.Get (1), Seconds (0.15), "route show table all");
-  kern = ar.Get (1)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (1)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
-
+  kernel.AddAddress (ar.Get (1), "sim0", "2001:1:2:3::3/64");
+  kernel.AddAddress (ar.Get (1), "sim1", "2001:1:2:7::2/64");
+  kernel.SetLinkUp (ar.Get (1), "lo");
+  kernel.SetLinkUp (ar.Get (1), "sim0");
+  kernel.SetLinkUp (ar.Get (1), "sim1");
+  kernel.AddRoute (ar.Get (1), mnp1 + "/64 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (1), "route show table all");
   LinuxStackHelper::SysctlGet (ar.Get (1), Seconds (1.0),
                                ".net.ipv6.conf.all.forwarding", &PrintFlags);
 
+  // IPv6 forwarding on both ARs
+  kernel.AddSysctl (ar, ".net.ipv6.conf.all.forwarding", "1");
+
   // For MR
   for (uint32_t i = 0; i < mr.GetN (); i++)
     {
-      RunIp (mr.Get (i), Seconds (0.11), "link set lo up");
-      RunIp (mr.Get (i), Seconds (0.11), "link set sim0 up");
-      RunIp (mr.Get (i), Seconds (3.0), "link set ip6tnl0 up");
-      //      RunIp (mr.Get (i), Seconds (3.1), "addr list");
-      oss.str ("");
-      oss << mnps->at (i) << "/64";
-      AddAddress (mr.Get (i), Seconds (0.12), "sim1", oss.str ().c_str ());
-      RunIp (mr.Get (i), Seconds (0.13), "link set sim1 up");
+      kernel.SetLinkUp (mr.Get (i), "lo");
+      kernel.SetLinkUp (mr.Get (i), "sim0");
+      kernel.AddAddress (mr.Get (i), "sim1", mnps->at (i) + "/64");
+      kernel.SetLinkUp (mr.Get (i), "sim1");
     }
 
   // For MNN
-  RunIp (mnn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (mnn.Get (0), Seconds (0.11), "link set sim0 up");
+  kernel.SetLinkUp (mnn.Get (0), "lo");
+  kernel.SetLinkUp (mnn.Get (0), "sim0");
 
   // For CN
-  RunIp (cn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (cn.Get (0), Seconds (1.11), "link set sim0 up");
-  RunIp (cn.Get (0), Seconds (1.11), "add default via 2001:1:2:6::2");
-  AddAddress (cn.Get (0), Seconds (0.12), "sim0", "2001:1:2:6::7/64");
+  kernel.SetLinkUp (cn.Get (0), "lo");
+  kernel.AddAddress (cn.Get (0), "sim0", "2001:1:2:6::7/64");
+  kernel.Install (Seconds (0.1));
+
+  kernel.SetLinkUp (cn.Get (0), "sim0");
+  kernel.AddIpCommand (cn.Get (0), "add default via 2001:1:2:6::2");
+  kernel.Install (Seconds (1.11));
+
+  // Once mip6d has created the tunnel devices
+  kernel.SetLinkUp (ha.Get (0), "ip6tnl0");
+  kernel.AddIpCommand (ha.Get (0), "addr list");
+  //  kernel.AddRoute (ha.Get (0), "default via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  for (uint32_t i = 0; i < mr.GetN (); i++)
+    {
+      kernel.SetLinkUp (mr.Get (i), "ip6tnl0");
+      //      kernel.AddIpCommand (mr.Get (i), "addr list");
+    }
+  kernel.Install (Seconds (3.0));
 
-  RunIp (ha.Get (0), Seconds (4.0), "addr list");
-  RunIp (ar.Get (0), Seconds (4.1), "addr list");
-  RunIp (mr.Get (0), Seconds (4.2), "addr list");
-  RunIp (ha.Get (0), Seconds (20.0), "route show table all");
-  RunIp (mr.Get (0), Seconds (20.0), "route show table all");
+  kernel.AddIpCommand (ha.Get (0), "addr list");
+  kernel.AddIpCommand (ar.Get (0), "addr list");
+  kernel.AddIpCommand (mr.Get (0), "addr list");
+  kernel.Install (Seconds (4.0));
+  kernel.AddIpCommand (ha.Get (0), "route show table all");
+  kernel.AddIpCommand (mr.Get (0), "route show table all");
+  kernel.Install (Seconds (20.0));
 
+  Ptr<Mip6FlowMonitor> flows;
   {
     ApplicationContainer apps;
     QuaggaHelper quagga;
     Mip6dHelper mip6d;
+    if (flowMonitor)
+      {
+        flows = mip6d.EnableFlowMonitor ();
+      }
+    if (goodput != "none")
+      {
+        mip6d.EnableHandoverTracing ();
+      }
 
     // HA
     mip6d.AddHaServedPrefix (ha.Get (0), Ipv6Address ("2001:1:2::"), Ipv6Prefix (48));
@@ -300,11 +336,55 @@ int main (int argc, char *argv[])
       apps.Start (Seconds (20.0));
     }
 
-  phy.EnablePcapAll ("dce-umip-nemo");
-  csma.EnablePcapAll ("dce-umip-nemo");
+  Ptr<Mip6GoodputSink> sink;
+  if (goodput != "none")
+    {
+      std::string factory = goodput == "tcp"
+        ? "ns3::LinuxTcp6SocketFactory" : "ns3::LinuxUdp6SocketFactory";
+      sink = CreateObject<Mip6GoodputSink> ();
+      sink->SetAttribute ("Protocol", TypeIdValue (TypeId::LookupByName (factory)));
+      sink->SetAttribute ("Local", AddressValue (Inet6SocketAddress (Ipv6Address::GetAny (), 9000)));
+      sink->TraceConnectWithoutContext ("Interruption", MakeBoundCallback (&Interrupted, mr.Get (0)));
+      cn.Get (0)->AddApplication (sink);
+      sink->SetStartTime (Seconds (15.0));
+
+      Ptr<Mip6GoodputSource> source = CreateObject<Mip6GoodputSource> ();
+      source->SetAttribute ("Protocol", TypeIdValue (TypeId::LookupByName (factory)));
+      source->SetAttribute ("Remote", AddressValue (Inet6SocketAddress (Ipv6Address ("2001:1:2:6::7"), 9000)));
+      mnn.Get (0)->AddApplication (source);
+      source->SetStartTime (Seconds (20.0));
+    }
+
+  if (flows)
+    {
+      flows->Install (NodeContainer (mnn, cn));
+    }
+
+  if (pcap == "all")
+    {
+      phy.EnablePcapAll ("dce-umip-nemo");
+      csma.EnablePcapAll ("dce-umip-nemo");
+    }
+  else if (pcap == "mip6")
+    {
+      Mip6PcapHelper mip6Pcap;
+      mip6Pcap.SetSnapLength (snapLen);
+      mip6Pcap.EnablePcapAll ("dce-umip-nemo");
+    }
 
   Simulator::Stop (Seconds (300.0));
   Simulator::Run ();
+  if (flows)
+    {
+      flows->Print (std::cout);
+    }
+  if (sink)
+    {
+      std::cout << "goodput records received " << sink->GetNReceived ()
+                << " lost " << sink->GetNLost ()
+                << " reordered " << sink->GetNReordered () << std::endl;
+      sink->Print (std::cout);
+    }
   Simulator::Destroy ();
 
   return 0;
@@ -37,6 +37,8 @@
 #include "ns3/internet-module.h"
 #include "ns3/dce-module.h"
 #include "ns3/mip6d-helper.h"
+#include "ns3/mip6-pcap-helper.h"
+#include "ns3/kernel-config-helper.h"
 #include "ns3/csma-helper.h"
 #include "ns3/wifi-helper.h"
 #include "ns3/yans-wifi-helper.h"
@@ -46,30 +48,14 @@
 
 using namespace ns3;
 
-static void RunIp (Ptr<Node> node, Time at, std::string str)
-{
-  DceApplicationHelper process;
-  ApplicationContainer apps;
-  process.SetBinary ("ip");
-  process.SetStackSize (1<<16);
-  process.ResetArguments();
-  process.ParseArguments(str.c_str ());
-  apps = process.Install (node);
-  apps.Start (at);
-}
-
-static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *address)
-{
-  std::ostringstream oss;
-  oss << "-f inet6 addr add " << address << " dev " << name;
-  RunIp (node, at, oss.str ());
-}
-
-
-
 int main (int argc, char *argv[])
 {
+  std::string pcap = "all";
+  uint32_t snapLen = 128;
   CommandLine cmd;
+  cmd.AddValue ("pcap", "Capture: all (full packets), mip6 (mobility signaling, "
+                "ND and tunnel headers only) or none", pcap);
+  cmd.AddValue ("snapLen", "Bytes kept per packet with --pcap=mip6", snapLen);
   cmd.Parse (argc, argv);
 
   NodeContainer mag, lma;
@@ -107,8 +93,17 @@ int main (int argc, char *argv[])
   phy.SetChannel (phyChannel.Create ());
   NetDeviceContainer mn_devices = wifi.Install (phy, mac, NodeContainer (mag.Get (0), mn.Get (0)));
 
-  phy.EnablePcapAll ("mip6d-pmip");
-  csma.EnablePcapAll ("mip6d-pmip");
+  if (pcap == "all")
+    {
+      phy.EnablePcapAll ("mip6d-pmip");
+      csma.EnablePcapAll ("mip6d-pmip");
+    }
+  else if (pcap == "mip6")
+    {
+      Mip6PcapHelper mip6Pcap;
+      mip6Pcap.SetSnapLength (snapLen);
+      mip6Pcap.EnablePcapAll ("mip6d-pmip");
+    }
 
   DceManagerHelper processManager;
   processManager.SetTaskManagerAttribute ("FiberManagerType", 
@@ -125,26 +120,33 @@ int main (int argc, char *argv[])
   std::string mag_sim0 ("2001:a:b:0::a/64");
   std::string hnp ("2001:a:b:1::1");
 
+  // Initial bring-up: one ip batch process per node
+  KernelConfigHelper kernel;
+
   // For LMA
-  AddAddress (lma.Get (0), Seconds (0.1), "sim0", lma_sim0.c_str ());
-  AddAddress (lma.Get (0), Seconds (0.11), "sim1", lma_sim1.c_str ());
-  RunIp (lma.Get (0), Seconds (0.21), "link set sim0 up");
-  RunIp (lma.Get (0), Seconds (0.22), "link set sim1 promisc on");
-  RunIp (lma.Get (0), Seconds (0.23), "link set sim1 up");
-  RunIp (lma.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (lma.Get (0), Seconds (3.1), "addr list");
+  kernel.AddAddress (lma.Get (0), "sim0", lma_sim0);
+  kernel.AddAddress (lma.Get (0), "sim1", lma_sim1);
+  kernel.SetLinkUp (lma.Get (0), "sim0");
+  kernel.AddIpCommand (lma.Get (0), "link set sim1 promisc on");
+  kernel.SetLinkUp (lma.Get (0), "sim1");
 
   // For MAG
-  AddAddress (mag.Get (0), Seconds (0.1), "sim0", mag_sim0.c_str ());
-  RunIp (mag.Get (0), Seconds (0.21), "link set sim0 up");
-  RunIp (mag.Get (0), Seconds (0.22), "link set sim1 promisc on");
-  RunIp (mag.Get (0), Seconds (0.23), "link set sim1 up");
-  RunIp (mag.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (mag.Get (0), Seconds (3.1), "addr list");
-
-
-  RunIp (lma.Get (0), Seconds (20.0), "route show table all");
-  RunIp (mag.Get (0), Seconds (20.0), "route show table all");
+  kernel.AddAddress (mag.Get (0), "sim0", mag_sim0);
+  kernel.SetLinkUp (mag.Get (0), "sim0");
+  kernel.AddIpCommand (mag.Get (0), "link set sim1 promisc on");
+  kernel.SetLinkUp (mag.Get (0), "sim1");
+  kernel.Install (Seconds (0.1));
+
+  // Once mip6d has created the tunnel devices
+  kernel.SetLinkUp (lma.Get (0), "ip6tnl0");
+  kernel.AddIpCommand (lma.Get (0), "addr list");
+  kernel.SetLinkUp (mag.Get (0), "ip6tnl0");
+  kernel.AddIpCommand (mag.Get (0), "addr list");
+  kernel.Install (Seconds (3.0));
+
+  kernel.AddIpCommand (lma.Get (0), "route show table all");
+  kernel.AddIpCommand (mag.Get (0), "route show table all");
+  kernel.Install (Seconds (20.0));
 
   {
     DceApplicationHelper process;
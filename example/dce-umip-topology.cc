@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+//
+// MIPv6/NEMO scenario of any size built by MobilityTopologyHelper.
+//
+// Home agents and access routers share the home link, each access
+// router serves its own wifi access link, and mobile nodes and routers
+// wander across the access routers. Prefixes, routes, radvd and mip6d
+// configuration are all derived from the counts:
+//
+// ./waf --run "dce-umip-topology --ha=2 --ar=16 --grid=1 --mn=8 --mr=4 --mnn=2"
+//
+
+#include "ns3/network-module.h"
+#include "ns3/core-module.h"
+#include "ns3/dce-module.h"
+#include "ns3/mip6d-helper.h"
+#include "ns3/kernel-config-helper.h"
+#include "ns3/setup-sequencer.h"
+#include "ns3/mobility-topology-helper.h"
+#include "ns3/mobility-module.h"
+#include "ns3/quagga-helper.h"
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+static ApplicationContainer
+StartPing6 (Ptr<Node> node, std::string target)
+{
+  DceApplicationHelper dce;
+  dce.SetBinary ("ping6");
+  dce.SetStackSize (1 << 16);
+  dce.ResetArguments ();
+  dce.ResetEnvironment ();
+  dce.AddArgument (target);
+  return dce.Install (node);
+}
+
+static std::string
+Uniform (double max)
+{
+  std::ostringstream os;
+  os << "ns3::UniformRandomVariable[Min=0.0|Max=" << max << "]";
+  return os.str ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nHa = 1;
+  uint32_t nAr = 4;
+  bool grid = false;
+  double spacing = 100.0;
+  uint32_t nMn = 2;
+  uint32_t nMr = 1;
+  uint32_t nMnn = 1;
+  double duration = 120.0;
+  CommandLine cmd;
+  cmd.AddValue ("ha", "Number of home agents", nHa);
+  cmd.AddValue ("ar", "Number of access routers", nAr);
+  cmd.AddValue ("grid", "Place the access routers on a grid instead of a line", grid);
+  cmd.AddValue ("spacing", "Distance between access routers, in meters", spacing);
+  cmd.AddValue ("mn", "Number of mobile nodes", nMn);
+  cmd.AddValue ("mr", "Number of mobile routers", nMr);
+  cmd.AddValue ("mnn", "Number of mobile network nodes per mobile router", nMnn);
+  cmd.AddValue ("duration", "Simulated time in seconds", duration);
+  cmd.Parse (argc, argv);
+
+  MobilityTopologyHelper topology;
+  topology.SetHomeAgents (nHa);
+  topology.SetAccessRouters (nAr, grid ? MobilityTopologyHelper::LAYOUT_GRID
+                             : MobilityTopologyHelper::LAYOUT_LINE, spacing);
+  topology.SetMobileNodes (nMn);
+  topology.SetMobileRouters (nMr, nMnn);
+  topology.SetCorrespondentNodes (1);
+  topology.Create ();
+
+  // mobiles wander over the area covered by the access routers
+  double maxX = 0;
+  double maxY = 0;
+  for (uint32_t i = 0; i < nAr; i++)
+    {
+      Vector position = topology.GetAccessRouterPosition (i);
+      maxX = std::max (maxX, position.x);
+      maxY = std::max (maxY, position.y);
+    }
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::RandomRectanglePositionAllocator",
+                                 "X", StringValue (Uniform (maxX)),
+                                 "Y", StringValue (Uniform (maxY)));
+  mobility.SetMobilityModel ("ns3::RandomDirection2dMobilityModel",
+                             "Bounds", RectangleValue (Rectangle (0, maxX + 1, 0, maxY + 1)),
+                             "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=10.0]"),
+                             "Pause", StringValue ("ns3::ConstantRandomVariable[Constant=0.2]"));
+  mobility.Install (topology.GetMobileNodes ());
+  mobility.Install (topology.GetMobileRouters ());
+
+  DceManagerHelper dceMng;
+  dceMng.SetTaskManagerAttribute ("FiberManagerType",
+                                  EnumValue (0));
+  dceMng.SetNetworkStack ("ns3::LinuxSocketFdFactory",
+                          "Library", StringValue ("liblinux.so"));
+  dceMng.Install (topology.GetNodes ());
+
+  Ptr<SetupSequencer> setup = CreateObject<SetupSequencer> ();
+  uint32_t bringUp = setup->AddKernelStep ("bring-up", topology.GetKernelConfig ());
+
+  Mip6dHelper mip6d;
+  mip6d.SetStartPolicy (CreateObjectWithAttributes<Mip6dAllAtOnceStartPolicy>
+                          ("Start", TimeValue (Seconds (0))));
+  mip6d.EnableHandoverTracing ();
+  NodeContainer daemons = topology.ConfigureMip6d (mip6d);
+  uint32_t mip6dStep = setup->AddMip6dStep ("mip6d", mip6d, daemons);
+  setup->After (mip6dStep, bringUp);
+
+  uint32_t tunnels = setup->AddKernelStep ("tunnels", topology.GetTunnelConfig ());
+  setup->After (tunnels, mip6dStep);
+
+  std::ostringstream cnAddress;
+  cnAddress << topology.GetCorrespondentAddress (0);
+  if (nMn > 0)
+    {
+      uint32_t ping = setup->AddStep ("ping6", MakeBoundCallback (&StartPing6,
+                                                                  topology.GetMobileNodes ().Get (0),
+                                                                  cnAddress.str ()),
+                                      false);
+      setup->After (ping, tunnels);
+      setup->AddRegistrationCondition (ping, topology.GetMobileNodes ().Get (0));
+    }
+
+  QuaggaHelper quagga;
+  quagga.Install (topology.ConfigureRadvd (quagga));
+
+  setup->Start (Seconds (0.1));
+
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  Mip6dHandoverTracer::PrintHandovers (std::cout);
+  Simulator::Destroy ();
+
+  return 0;
+}
@@ -10,6 +10,11 @@
 cpp_examples = [
     ("dce-umip-cmip6", "True", "True"),
     ("dce-umip-nemo", "True", "True"),
+    ("dce-umip-nemo --goodput=udp --usePing=0 --pcap=none", "True", "False"),
+    ("dce-umip-bu-load", "True", "False"),
+    ("dce-umip-topology", "True", "False"),
+    ("dce-umip-bench --modes=cmip6 --mn=1 --handover=0 --duration=20", "True", "False"),
+    ("dce-umip-bench --modes=cmip6 --mn=1 --handover=0 --ro=0,1 --duration=30", "True", "False"),
     # not supported yet
     ("dce-umip-pmip6", "False", "False"),
     ("dce-umip-dsmip6-tap-ha", "False", "False"),
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "kernel-config-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/linux-socket-fd-factory.h"
+#include "ns3/dce-application-helper.h"
+#include "ns3/application-container.h"
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace ns3 {
+
+KernelConfigHelper::KernelConfigHelper ()
+{
+}
+
+KernelConfigHelper::NodeConfig &
+KernelConfigHelper::GetNodeConfig (Ptr<Node> node)
+{
+  NodeConfig &config = m_nodes[node->GetId ()];
+  config.node = node;
+  return config;
+}
+
+void
+KernelConfigHelper::AddSysctl (NodeContainer nodes, std::string key, std::string value)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      GetNodeConfig (nodes.Get (i)).sysctls.push_back (std::make_pair (key, value));
+    }
+}
+
+void
+KernelConfigHelper::AddAddress (Ptr<Node> node, std::string ifname, std::string address)
+{
+  AddIpCommand (node, "addr add " + address + " dev " + ifname);
+}
+
+void
+KernelConfigHelper::SetLinkUp (Ptr<Node> node, std::string ifname)
+{
+  AddIpCommand (node, "link set " + ifname + " up");
+}
+
+void
+KernelConfigHelper::SetLinkUp (NodeContainer nodes, std::string ifname)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      SetLinkUp (nodes.Get (i), ifname);
+    }
+}
+
+void
+KernelConfigHelper::AddRoute (Ptr<Node> node, std::string route)
+{
+  AddIpCommand (node, "route add " + route);
+}
+
+void
+KernelConfigHelper::AddIpCommand (Ptr<Node> node, std::string command)
+{
+  GetNodeConfig (node).commands.push_back (command);
+}
+
+std::vector<std::string>
+KernelConfigHelper::GetIpCommands (Ptr<Node> node) const
+{
+  std::map<uint32_t, NodeConfig>::const_iterator it = m_nodes.find (node->GetId ());
+  if (it == m_nodes.end ())
+    {
+      return std::vector<std::string> ();
+    }
+  return it->second.commands;
+}
+
+// Write the commands where the node's ip process will find them and
+// return the path as seen from inside the node.
+static std::string
+WriteIpBatch (uint32_t nodeId, const std::vector<std::string> &commands)
+{
+  // shared by every helper instance, so that batches never overwrite
+  // each other
+  static uint32_t batchId = 0;
+  std::ostringstream dir, name;
+  dir << "files-" << nodeId;
+  ::mkdir (dir.str ().c_str (), S_IRWXU | S_IRWXG);
+  dir << "/tmp/";
+  ::mkdir (dir.str ().c_str (), S_IRWXU | S_IRWXG);
+
+  name << "ip-" << batchId++ << ".batch";
+  std::ofstream batch ((dir.str () + name.str ()).c_str ());
+  for (uint32_t i = 0; i < commands.size (); i++)
+    {
+      batch << commands[i] << std::endl;
+    }
+  batch.close ();
+  return "/tmp/" + name.str ();
+}
+
+static void
+ApplySysctls (Ptr<LinuxSocketFdFactory> kern,
+              std::vector<std::pair<std::string, std::string> > sysctls)
+{
+  for (uint32_t i = 0; i < sysctls.size (); i++)
+    {
+      kern->Set (sysctls[i].first, sysctls[i].second);
+    }
+}
+
+ApplicationContainer
+KernelConfigHelper::Install (Time at)
+{
+  ApplicationContainer processes;
+  // DCE finds the node a kernel call is for through the event context,
+  // hence one event per node rather than a single one for all of them
+  for (std::map<uint32_t, NodeConfig>::iterator i = m_nodes.begin ();
+       i != m_nodes.end (); ++i)
+    {
+      NodeConfig &config = i->second;
+      if (!config.sysctls.empty ())
+        {
+          Ptr<LinuxSocketFdFactory> kern = config.node->GetObject<LinuxSocketFdFactory> ();
+          Simulator::ScheduleWithContext (config.node->GetId (), at,
+                                          &ApplySysctls, kern, config.sysctls);
+        }
+      if (!config.commands.empty ())
+        {
+          // -force keeps going past a failing line, as separate ip
+          // processes would
+          DceApplicationHelper process;
+          ApplicationContainer apps;
+          process.SetBinary ("ip");
+          process.SetStackSize (1 << 16);
+          process.ResetArguments ();
+          process.ParseArguments ("-force -batch " +
+                                  WriteIpBatch (config.node->GetId (), config.commands));
+          apps = process.Install (config.node);
+          apps.Start (at);
+          processes.Add (apps);
+        }
+    }
+  m_nodes.clear ();
+  return processes;
+}
+
+} // namespace ns3
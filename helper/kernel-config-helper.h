@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef KERNEL_CONFIG_HELPER_H
+#define KERNEL_CONFIG_HELPER_H
+
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+#include "ns3/nstime.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief apply Linux kernel settings to nodes in batches
+ *
+ * Settings are queued per node, then Install () schedules a single event
+ * per node which applies all of them at once, instead of one event per
+ * node and per setting.
+ *
+ * Address, link and route changes are written to a batch file in the
+ * node's filesystem and applied by a single "ip -batch" process per node,
+ * instead of one ip process per command. The commands are run in the
+ * order they were queued.
+ */
+class KernelConfigHelper
+{
+public:
+  KernelConfigHelper ();
+
+  /**
+   * \brief Queue a sysctl for every node of a container
+   * \param nodes the nodes to configure
+   * \param key sysctl path, e.g. ".net.ipv6.conf.all.forwarding"
+   * \param value the value to set
+   */
+  void AddSysctl (NodeContainer nodes, std::string key, std::string value);
+
+  /**
+   * \brief Queue an address for an interface
+   * \param node the node to configure
+   * \param ifname interface name, e.g. "sim0"
+   * \param address address with prefix length, e.g. "2001:1:2:3::1/64"
+   */
+  void AddAddress (Ptr<Node> node, std::string ifname, std::string address);
+
+  /**
+   * \brief Queue bringing an interface up
+   * \param node the node to configure
+   * \param ifname interface name
+   */
+  void SetLinkUp (Ptr<Node> node, std::string ifname);
+
+  /**
+   * \brief Queue bringing an interface up on every node of a container
+   * \param nodes the nodes to configure
+   * \param ifname interface name
+   */
+  void SetLinkUp (NodeContainer nodes, std::string ifname);
+
+  /**
+   * \brief Queue a route
+   * \param node the node to configure
+   * \param route route specification as given to "ip route add",
+   * e.g. "2001:1:2::/48 via 2001:1:2:3::1 dev sim0"
+   */
+  void AddRoute (Ptr<Node> node, std::string route);
+
+  /**
+   * \brief Queue any other ip command
+   * \param node the node to configure
+   * \param command ip command line without global options,
+   * e.g. "link set sim1 promisc on" or "addr list"
+   */
+  void AddIpCommand (Ptr<Node> node, std::string command);
+
+  /**
+   * \param node a node
+   * \returns the ip commands queued for the node, in order, e.g.
+   * "route add 2001:1:2::/48 via 2001:1:2:3::1 dev sim0"
+   */
+  std::vector<std::string> GetIpCommands (Ptr<Node> node) const;
+
+  /**
+   * \brief Schedule one event per node applying the queued sysctls and
+   * one ip process per node running the queued ip commands, then clear
+   * the queue
+   * \param at when to apply the settings, relative to now
+   * \returns the ip processes
+   */
+  ApplicationContainer Install (Time at);
+
+private:
+  typedef std::vector<std::pair<std::string, std::string> > SysctlList;
+  struct NodeConfig
+  {
+    Ptr<Node> node;
+    SysctlList sysctls;
+    std::vector<std::string> commands;
+  };
+
+  NodeConfig &GetNodeConfig (Ptr<Node> node);
+
+  // keyed by node id, so that events are scheduled in node order
+  std::map<uint32_t, NodeConfig> m_nodes;
+};
+
+} // namespace ns3
+
+#endif /* KERNEL_CONFIG_HELPER_H */
@@ -0,0 +1,469 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6-binding-update-generator.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6BindingUpdateGenerator");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6BindingUpdateGenerator);
+
+enum
+{
+  IPV6_HEADER_SIZE = 40,
+  ETHERTYPE_IPV6 = 0x86DD,
+  NH_ICMPV6 = 58,
+  NH_NONE = 59,
+  NH_DSTOPTS = 60,
+  NH_MH = 135,
+  // Destination Options header carrying the Home Address option
+  HAO_DSTOPTS_SIZE = 24,
+  // BU with PadN to a multiple of 8 bytes
+  MH_BU_SIZE = 16,
+  // Neighbor Advertisement with a target link-layer address option
+  ICMPV6_NA_SIZE = 32,
+  BA_STATUS_REJECTED = 128,
+  BA_STATUS_SEQUENCE_OUT_OF_WINDOW = 135
+};
+
+TypeId
+Mip6BindingUpdateGenerator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6BindingUpdateGenerator")
+    .SetParent<Application> ()
+    .AddConstructor<Mip6BindingUpdateGenerator> ()
+    .AddAttribute ("HomeAgent", "Address of the home agent.",
+                   Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1")),
+                   MakeIpv6AddressAccessor (&Mip6BindingUpdateGenerator::m_homeAgent),
+                   MakeIpv6AddressChecker ())
+    .AddAttribute ("HomeAddressBase", "Home address of the first binding.",
+                   Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1:0")),
+                   MakeIpv6AddressAccessor (&Mip6BindingUpdateGenerator::m_homeAddressBase),
+                   MakeIpv6AddressChecker ())
+    .AddAttribute ("CareOfAddressBase", "Care-of address of the first binding.",
+                   Ipv6AddressValue (Ipv6Address ("2001:1:2:4::1:0")),
+                   MakeIpv6AddressAccessor (&Mip6BindingUpdateGenerator::m_careOfAddressBase),
+                   MakeIpv6AddressChecker ())
+    .AddAttribute ("NBindings", "Number of virtual mobile nodes.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&Mip6BindingUpdateGenerator::m_nBindings),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Rate", "Initial registrations per second.",
+                   DoubleValue (100),
+                   MakeDoubleAccessor (&Mip6BindingUpdateGenerator::m_rate),
+                   MakeDoubleChecker<double> (0.001))
+    .AddAttribute ("Lifetime", "Binding lifetime requested in each Binding Update.",
+                   TimeValue (Seconds (60)),
+                   MakeTimeAccessor (&Mip6BindingUpdateGenerator::m_lifetime),
+                   MakeTimeChecker ())
+    .AddAttribute ("Refresh", "Fraction of the granted lifetime after which a binding "
+                   "is refreshed.",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&Mip6BindingUpdateGenerator::m_refresh),
+                   MakeDoubleChecker<double> (0.01, 1))
+    .AddAttribute ("InitialTimeout", "Time to wait for a Binding Acknowledgement before "
+                   "the first retransmission.",
+                   TimeValue (Seconds (1.5)),
+                   MakeTimeAccessor (&Mip6BindingUpdateGenerator::m_initialTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxTimeout", "Upper bound of the retransmission backoff.",
+                   TimeValue (Seconds (32)),
+                   MakeTimeAccessor (&Mip6BindingUpdateGenerator::m_maxTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("RetryRejected", "Keep retransmitting, with backoff, the Binding "
+                   "Updates the home agent rejects with a status other than 'sequence "
+                   "out of window'. Such a binding is otherwise given up.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Mip6BindingUpdateGenerator::m_retryRejected),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DeviceIndex", "Index of the node device facing the home agent.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&Mip6BindingUpdateGenerator::m_deviceIndex),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Gateway", "Link-layer destination of the Binding Updates until the "
+                   "home agent has been heard from.",
+                   Mac48AddressValue (Mac48Address ("ff:ff:ff:ff:ff:ff")),
+                   MakeMac48AddressAccessor (&Mip6BindingUpdateGenerator::m_gateway),
+                   MakeMac48AddressChecker ())
+    .AddTraceSource ("BuSent", "A Binding Update was sent: binding index and sequence number.",
+                     MakeTraceSourceAccessor (&Mip6BindingUpdateGenerator::m_buSentTrace),
+                     "ns3::Mip6BindingUpdateGenerator::BuSentCallback")
+    .AddTraceSource ("BaReceived", "The Binding Acknowledgement of the last Binding Update "
+                     "of a binding was received: binding index, status and time since "
+                     "the Binding Update.",
+                     MakeTraceSourceAccessor (&Mip6BindingUpdateGenerator::m_baReceivedTrace),
+                     "ns3::Mip6BindingUpdateGenerator::BaReceivedCallback")
+  ;
+  return tid;
+}
+
+Mip6BindingUpdateGenerator::Mip6BindingUpdateGenerator ()
+  : m_handlerRegistered (false),
+    m_nextRegistration (0),
+    m_nRegistered (0),
+    m_nBuSent (0),
+    m_nBaReceived (0),
+    m_nRejected (0)
+{
+}
+
+Mip6BindingUpdateGenerator::~Mip6BindingUpdateGenerator ()
+{
+}
+
+void
+Mip6BindingUpdateGenerator::DoDispose (void)
+{
+  m_device = 0;
+  m_bindings.clear ();
+  Application::DoDispose ();
+}
+
+static Ipv6Address
+AddressAt (Ipv6Address base, uint32_t index)
+{
+  uint8_t bytes[16];
+  base.GetBytes (bytes);
+  uint32_t low = (bytes[12] << 24) | (bytes[13] << 16) | (bytes[14] << 8) | bytes[15];
+  low += index;
+  bytes[12] = low >> 24;
+  bytes[13] = low >> 16;
+  bytes[14] = low >> 8;
+  bytes[15] = low;
+  return Ipv6Address (bytes);
+}
+
+bool
+Mip6BindingUpdateGenerator::GetIndex (Ipv6Address address, Ipv6Address base,
+                                      uint32_t &index) const
+{
+  uint8_t a[16];
+  uint8_t b[16];
+  address.GetBytes (a);
+  base.GetBytes (b);
+  if (!std::equal (a, a + 12, b))
+    {
+      return false;
+    }
+  uint32_t low = (a[12] << 24) | (a[13] << 16) | (a[14] << 8) | a[15];
+  uint32_t baseLow = (b[12] << 24) | (b[13] << 16) | (b[14] << 8) | b[15];
+  index = low - baseLow;
+  return index < m_bindings.size ();
+}
+
+static void
+WriteU16 (uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value;
+}
+
+static void
+WriteIpv6Header (uint8_t *p, uint16_t payloadLength, uint8_t next, uint8_t hopLimit,
+                 Ipv6Address source, Ipv6Address destination)
+{
+  p[0] = 0x60;
+  p[1] = p[2] = p[3] = 0;
+  WriteU16 (p + 4, payloadLength);
+  p[6] = next;
+  p[7] = hopLimit;
+  source.Serialize (p + 8);
+  destination.Serialize (p + 24);
+}
+
+// upper-layer checksum over the IPv6 pseudo-header (RFC 2460, section 8.1)
+static uint16_t
+Checksum (Ipv6Address source, Ipv6Address destination, uint8_t protocol,
+          const uint8_t *data, uint32_t size)
+{
+  uint8_t addresses[32];
+  source.Serialize (addresses);
+  destination.Serialize (addresses + 16);
+  uint32_t sum = (size >> 16) + (size & 0xffff) + protocol;
+  for (uint32_t i = 0; i < sizeof (addresses); i += 2)
+    {
+      sum += (addresses[i] << 8) | addresses[i + 1];
+    }
+  for (uint32_t i = 0; i + 1 < size; i += 2)
+    {
+      sum += (data[i] << 8) | data[i + 1];
+    }
+  if (size & 1)
+    {
+      sum += data[size - 1] << 8;
+    }
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return ~sum;
+}
+
+void
+Mip6BindingUpdateGenerator::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_device = GetNode ()->GetDevice (m_deviceIndex);
+  if (!m_handlerRegistered)
+    {
+      GetNode ()->RegisterProtocolHandler (MakeCallback (&Mip6BindingUpdateGenerator::Receive,
+                                                         this),
+                                           ETHERTYPE_IPV6, m_device, false);
+      m_handlerRegistered = true;
+    }
+
+  Binding binding;
+  binding.sequence = 0;
+  binding.registered = false;
+  binding.timeout = m_initialTimeout;
+  m_bindings.assign (m_nBindings, binding);
+  m_nextRegistration = 0;
+  m_nRegistered = 0;
+  RegisterNext ();
+}
+
+void
+Mip6BindingUpdateGenerator::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_registerEvent.Cancel ();
+  for (std::vector<Binding>::iterator i = m_bindings.begin (); i != m_bindings.end (); ++i)
+    {
+      i->timer.Cancel ();
+    }
+  // late acknowledgements are ignored from now on
+  m_bindings.clear ();
+}
+
+void
+Mip6BindingUpdateGenerator::RegisterNext (void)
+{
+  if (m_nextRegistration >= m_bindings.size ())
+    {
+      return;
+    }
+  SendBindingUpdate (m_nextRegistration++);
+  m_registerEvent = Simulator::Schedule (Seconds (1 / m_rate),
+                                         &Mip6BindingUpdateGenerator::RegisterNext, this);
+}
+
+void
+Mip6BindingUpdateGenerator::SendBindingUpdate (uint32_t index)
+{
+  Binding &binding = m_bindings[index];
+  binding.sequence++;
+  binding.sent = Simulator::Now ();
+
+  Ipv6Address homeAddress = AddressAt (m_homeAddressBase, index);
+  uint8_t buffer[IPV6_HEADER_SIZE + HAO_DSTOPTS_SIZE + MH_BU_SIZE] = { 0 };
+  WriteIpv6Header (buffer, HAO_DSTOPTS_SIZE + MH_BU_SIZE, NH_DSTOPTS, 64,
+                   AddressAt (m_careOfAddressBase, index), m_homeAgent);
+
+  // PadN, then the Home Address option at 8n+6
+  uint8_t *options = buffer + IPV6_HEADER_SIZE;
+  options[0] = NH_MH;
+  options[1] = HAO_DSTOPTS_SIZE / 8 - 1;
+  options[2] = 1;
+  options[3] = 2;
+  options[6] = 201;
+  options[7] = 16;
+  homeAddress.Serialize (options + 8);
+
+  // home registration (A and H flags), then PadN
+  uint8_t *mh = options + HAO_DSTOPTS_SIZE;
+  mh[0] = NH_NONE;
+  mh[1] = MH_BU_SIZE / 8 - 1;
+  mh[2] = Mip6PacketInfo::MH_BU;
+  WriteU16 (mh + 6, binding.sequence);
+  mh[8] = 0xc0;
+  WriteU16 (mh + 10, std::min<int64_t> (m_lifetime.GetSeconds () / 4, 0xffff));
+  mh[12] = 1;
+  mh[13] = 2;
+  // the receiver checks it against the home address, after the swap
+  WriteU16 (mh + 4, Checksum (homeAddress, m_homeAgent, NH_MH, mh, MH_BU_SIZE));
+
+  m_device->Send (Create<Packet> (buffer, sizeof (buffer)), m_gateway, ETHERTYPE_IPV6);
+  m_nBuSent++;
+  m_buSentTrace (index, binding.sequence);
+
+  binding.timer.Cancel ();
+  binding.timer = Simulator::Schedule (binding.timeout, &Mip6BindingUpdateGenerator::Retransmit,
+                                       this, index);
+}
+
+void
+Mip6BindingUpdateGenerator::Retransmit (uint32_t index)
+{
+  Binding &binding = m_bindings[index];
+  NS_LOG_LOGIC ("no BA for binding " << index << " seq " << binding.sequence);
+  binding.timeout = std::min (binding.timeout + binding.timeout, m_maxTimeout);
+  SendBindingUpdate (index);
+}
+
+void
+Mip6BindingUpdateGenerator::Refresh (uint32_t index)
+{
+  m_bindings[index].timeout = m_initialTimeout;
+  SendBindingUpdate (index);
+}
+
+void
+Mip6BindingUpdateGenerator::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                                     uint16_t protocol, const Address &from,
+                                     const Address &to, NetDevice::PacketType type)
+{
+  Mip6PacketInfo info;
+  if (m_bindings.empty () || !Mip6PacketParser::Parse (packet, info))
+    {
+      return;
+    }
+  if (info.hasMobilityHeader && info.mhType == Mip6PacketInfo::MH_BA)
+    {
+      ReceiveBindingAck (info);
+    }
+  else if (!info.tunneled && info.protocol == NH_ICMPV6
+           && info.icmpType == Mip6PacketInfo::ND_NEIGHBOR_SOLICITATION)
+    {
+      AnswerNeighborSolicitation (info, from);
+    }
+}
+
+void
+Mip6BindingUpdateGenerator::ReceiveBindingAck (const Mip6PacketInfo &info)
+{
+  uint32_t index;
+  if (!(info.hasRoutingHeader2 && GetIndex (info.routingHomeAddress, m_homeAddressBase, index))
+      && !GetIndex (info.destination, m_careOfAddressBase, index))
+    {
+      return;
+    }
+  m_nBaReceived++;
+  Binding &binding = m_bindings[index];
+
+  // the home agent tells the last sequence number it accepted
+  if (info.status == BA_STATUS_SEQUENCE_OUT_OF_WINDOW)
+    {
+      NS_LOG_LOGIC ("binding " << index << " resyncs to seq " << info.sequence);
+      binding.sequence = info.sequence;
+      SendBindingUpdate (index);
+      return;
+    }
+  if (info.sequence != binding.sequence)
+    {
+      return;
+    }
+  m_baReceivedTrace (index, info.status, Simulator::Now () - binding.sent);
+  binding.timer.Cancel ();
+
+  if (info.status >= BA_STATUS_REJECTED || info.lifetime == 0)
+    {
+      NS_LOG_LOGIC ("binding " << index << " rejected, status " << (uint32_t)info.status);
+      if (info.status >= BA_STATUS_REJECTED)
+        {
+          m_nRejected++;
+        }
+      if (binding.registered)
+        {
+          binding.registered = false;
+          m_nRegistered--;
+        }
+      // the other rejections will not change on their own: retrying
+      // would only inflate the BU count
+      if (info.status >= BA_STATUS_REJECTED && !m_retryRejected)
+        {
+          return;
+        }
+      binding.timer = Simulator::Schedule (binding.timeout,
+                                           &Mip6BindingUpdateGenerator::Retransmit,
+                                           this, index);
+      return;
+    }
+
+  if (!binding.registered)
+    {
+      binding.registered = true;
+      m_nRegistered++;
+    }
+  binding.timeout = m_initialTimeout;
+  Time granted = Seconds (info.lifetime * 4);
+  binding.timer = Simulator::Schedule (Seconds (granted.GetSeconds () * m_refresh),
+                                       &Mip6BindingUpdateGenerator::Refresh, this, index);
+}
+
+void
+Mip6BindingUpdateGenerator::AnswerNeighborSolicitation (const Mip6PacketInfo &info,
+                                                        const Address &from)
+{
+  uint32_t index;
+  // DAD probes are not ours to answer
+  if (info.source.IsAny () || !GetIndex (info.ndTarget, m_careOfAddressBase, index))
+    {
+      return;
+    }
+  // whoever resolves our care-of addresses is on the path to the home agent
+  m_gateway = Mac48Address::ConvertFrom (from);
+
+  uint8_t buffer[IPV6_HEADER_SIZE + ICMPV6_NA_SIZE] = { 0 };
+  WriteIpv6Header (buffer, ICMPV6_NA_SIZE, NH_ICMPV6, 255, info.ndTarget, info.source);
+  uint8_t *na = buffer + IPV6_HEADER_SIZE;
+  na[0] = Mip6PacketInfo::ND_NEIGHBOR_ADVERTISEMENT;
+  // solicited, override
+  na[4] = 0x60;
+  info.ndTarget.Serialize (na + 8);
+  // target link-layer address option
+  na[24] = 2;
+  na[25] = 1;
+  Mac48Address::ConvertFrom (m_device->GetAddress ()).CopyTo (na + 26);
+  WriteU16 (na + 2, Checksum (info.ndTarget, info.source, NH_ICMPV6, na, ICMPV6_NA_SIZE));
+
+  m_device->Send (Create<Packet> (buffer, sizeof (buffer)), from, ETHERTYPE_IPV6);
+}
+
+uint32_t
+Mip6BindingUpdateGenerator::GetNRegistered (void) const
+{
+  return m_nRegistered;
+}
+
+uint64_t
+Mip6BindingUpdateGenerator::GetNBuSent (void) const
+{
+  return m_nBuSent;
+}
+
+uint64_t
+Mip6BindingUpdateGenerator::GetNBaReceived (void) const
+{
+  return m_nBaReceived;
+}
+
+uint64_t
+Mip6BindingUpdateGenerator::GetNRejected (void) const
+{
+  return m_nRejected;
+}
+
+} // namespace ns3
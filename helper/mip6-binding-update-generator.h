@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6_BINDING_UPDATE_GENERATOR_H
+#define MIP6_BINDING_UPDATE_GENERATOR_H
+
+#include "ns3/application.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "mip6-packet-parser.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief register many virtual mobile nodes with a real home agent
+ *
+ * The application plays NBindings mobile nodes without running mip6d for
+ * each: binding i has home address HomeAddressBase + i and care-of
+ * address CareOfAddressBase + i. It sends home registration Binding
+ * Updates (with a Home Address option, no IPsec, as mip6d's HA is
+ * configured by Mip6dHelper) at Rate, retransmits them with exponential
+ * backoff until acknowledged, and refreshes each binding when Refresh of
+ * its granted lifetime has elapsed. A binding the home agent rejects, for
+ * any reason but an out of window sequence number, is given up unless
+ * RetryRejected is set.
+ *
+ * Packets are built and parsed as raw bytes and go straight through one
+ * NetDevice of the node, so the node needs no IP stack: install the
+ * application on a node whose device shares a link with the home agent
+ * and whose care-of addresses are on-link for it. The application answers
+ * the Neighbor Solicitations for its care-of addresses and learns the
+ * link-layer address of the home agent from them; until then Binding
+ * Updates go to Gateway (broadcast by default).
+ */
+class Mip6BindingUpdateGenerator : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6BindingUpdateGenerator ();
+  virtual ~Mip6BindingUpdateGenerator ();
+
+  /**
+   * \returns the number of bindings currently accepted by the home agent
+   */
+  uint32_t GetNRegistered (void) const;
+  /**
+   * \returns the number of Binding Updates sent, retransmissions included
+   */
+  uint64_t GetNBuSent (void) const;
+  /**
+   * \returns the number of Binding Acknowledgements received
+   */
+  uint64_t GetNBaReceived (void) const;
+  /**
+   * \returns the number of Binding Acknowledgements with a rejection status
+   */
+  uint64_t GetNRejected (void) const;
+
+private:
+  struct Binding
+  {
+    uint16_t sequence;
+    bool registered;
+    // current retransmission timeout
+    Time timeout;
+    Time sent;
+    EventId timer;
+  };
+
+  virtual void DoDispose (void);
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void RegisterNext (void);
+  void SendBindingUpdate (uint32_t index);
+  void Retransmit (uint32_t index);
+  void Refresh (uint32_t index);
+  void Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                const Address &from, const Address &to, NetDevice::PacketType type);
+  void ReceiveBindingAck (const Mip6PacketInfo &info);
+  void AnswerNeighborSolicitation (const Mip6PacketInfo &info, const Address &from);
+  bool GetIndex (Ipv6Address address, Ipv6Address base, uint32_t &index) const;
+
+  Ipv6Address m_homeAgent;
+  Ipv6Address m_homeAddressBase;
+  Ipv6Address m_careOfAddressBase;
+  uint32_t m_nBindings;
+  double m_rate;
+  Time m_lifetime;
+  double m_refresh;
+  Time m_initialTimeout;
+  Time m_maxTimeout;
+  bool m_retryRejected;
+  uint32_t m_deviceIndex;
+  Mac48Address m_gateway;
+
+  Ptr<NetDevice> m_device;
+  bool m_handlerRegistered;
+  std::vector<Binding> m_bindings;
+  uint32_t m_nextRegistration;
+  EventId m_registerEvent;
+  uint32_t m_nRegistered;
+  uint64_t m_nBuSent;
+  uint64_t m_nBaReceived;
+  uint64_t m_nRejected;
+
+  TracedCallback<uint32_t, uint16_t> m_buSentTrace;
+  TracedCallback<uint32_t, uint8_t, Time> m_baReceivedTrace;
+};
+
+} // namespace ns3
+
+#endif /* MIP6_BINDING_UPDATE_GENERATOR_H */
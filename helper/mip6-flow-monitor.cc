@@ -0,0 +1,403 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6-flow-monitor.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6FlowMonitor");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6FlowMonitor);
+
+enum
+{
+  // an IPv4 header with options, a UDP header and what Mip6PacketParser
+  // reads of the inner IPv6 packet
+  PEEK_BYTES = 320,
+  // bytes after the upper-layer header start which tell the packets of
+  // a flow apart: ports, checksum, TCP sequence, ICMPv6 echo sequence
+  // and the sequence numbers traffic generators put first
+  HASHED_PAYLOAD = 32,
+  IPV6_HOP_LIMIT = 7,
+  PROTO_TCP = 6,
+  PROTO_UDP = 17,
+  PROTO_ICMPV6 = 58,
+  ICMPV6_ECHO_REQUEST = 128,
+  ICMPV6_ECHO_REPLY = 129
+};
+
+bool
+operator < (const Mip6FlowKey &a, const Mip6FlowKey &b)
+{
+  uint8_t ab[16], bb[16];
+  a.source.Serialize (ab);
+  b.source.Serialize (bb);
+  int c = std::memcmp (ab, bb, 16);
+  if (c != 0)
+    {
+      return c < 0;
+    }
+  a.destination.Serialize (ab);
+  b.destination.Serialize (bb);
+  c = std::memcmp (ab, bb, 16);
+  if (c != 0)
+    {
+      return c < 0;
+    }
+  if (a.protocol != b.protocol)
+    {
+      return a.protocol < b.protocol;
+    }
+  if (a.sourcePort != b.sourcePort)
+    {
+      return a.sourcePort < b.sourcePort;
+    }
+  return a.destinationPort < b.destinationPort;
+}
+
+Mip6FlowStats::Mip6FlowStats ()
+  : txBytes (0),
+    rxBytes (0),
+    txPackets (0),
+    rxPackets (0),
+    lostPackets (0),
+    tunneledPackets (0),
+    overheadBytes (0)
+{
+}
+
+TypeId
+Mip6FlowMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6FlowMonitor")
+    .SetParent<Object> ()
+    .AddConstructor<Mip6FlowMonitor> ()
+    .AddAttribute ("Dsmip6Port", "UDP port of DSMIP6 encapsulation (RFC 5555).",
+                   UintegerValue (4191),
+                   MakeUintegerAccessor (&Mip6FlowMonitor::m_dsmip6Port),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("MaxDelay", "A packet not received this long after it was sent is lost.",
+                   TimeValue (Seconds (10.0)),
+                   MakeTimeAccessor (&Mip6FlowMonitor::m_maxDelay),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+Mip6FlowMonitor::Mip6FlowMonitor ()
+  : m_dsmip6Port (4191),
+    m_maxDelay (Seconds (10.0))
+{
+}
+
+void
+Mip6FlowMonitor::DoDispose (void)
+{
+  m_checkEvent.Cancel ();
+  m_inFlight.clear ();
+  Object::DoDispose ();
+}
+
+void
+Mip6FlowMonitor::Start (void)
+{
+  if (!m_checkEvent.IsRunning ())
+    {
+      m_checkEvent = Simulator::Schedule (m_maxDelay, &Mip6FlowMonitor::PeriodicCheckForLostPackets,
+                                          this);
+    }
+}
+
+void
+Mip6FlowMonitor::Install (Ptr<Node> node)
+{
+  NS_ABORT_MSG_IF (m_tunnels.find (node->GetId ()) != m_tunnels.end (),
+                   "node " << node->GetId () << " is already watched as a tunnel end");
+  if (!m_endpoints.insert (node->GetId ()).second)
+    {
+      return;
+    }
+  Mip6PacketTap::Install (node, MakeCallback (&Mip6FlowMonitor::Tap,
+                                              Ptr<Mip6FlowMonitor> (this)),
+                          true, true, true);
+  Start ();
+}
+
+void
+Mip6FlowMonitor::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Install (*i);
+    }
+}
+
+void
+Mip6FlowMonitor::WatchTunnel (Ptr<Node> node)
+{
+  NS_ABORT_MSG_IF (m_endpoints.find (node->GetId ()) != m_endpoints.end (),
+                   "node " << node->GetId () << " is already monitored as an endpoint");
+  if (!m_tunnels.insert (node->GetId ()).second)
+    {
+      return;
+    }
+  Mip6PacketTap::Install (node, MakeCallback (&Mip6FlowMonitor::TunnelTap,
+                                              Ptr<Mip6FlowMonitor> (this)),
+                          false, true, true);
+  Start ();
+}
+
+Mip6FlowMonitor::FlowId
+Mip6FlowMonitor::GetFlowId (const Mip6FlowKey &key)
+{
+  std::map<Mip6FlowKey, FlowId>::iterator i = m_flowIds.find (key);
+  if (i != m_flowIds.end ())
+    {
+      return i->second;
+    }
+  FlowId id = m_flowIds.size () + 1;
+  m_flowIds[key] = id;
+  m_flowKeys[id] = key;
+  m_flowStats[id];
+  return id;
+}
+
+bool
+Mip6FlowMonitor::Classify (Ptr<const Packet> packet, FlowId &flow, uint64_t &hash,
+                           uint32_t &innerOffset, bool &encapsulated)
+{
+  uint8_t buffer[PEEK_BYTES];
+  uint32_t size = packet->CopyData (buffer, sizeof (buffer));
+  Mip6PacketInfo info;
+  if (size > 0 && (buffer[0] >> 4) == 4)
+    {
+      if (!Mip6PacketParser::ParseIpv4 (buffer, size, m_dsmip6Port, info))
+        {
+          return false;
+        }
+      encapsulated = true;
+    }
+  else
+    {
+      if (!Mip6PacketParser::Parse (buffer, size, info))
+        {
+          return false;
+        }
+      encapsulated = info.tunneled;
+    }
+  // ND, MLD and the Mobile IPv6 ICMPv6 messages are no flow
+  if (info.hasMobilityHeader
+      || (info.protocol == PROTO_ICMPV6 && info.icmpType > ICMPV6_ECHO_REPLY))
+    {
+      return false;
+    }
+
+  Mip6FlowKey key;
+  key.source = info.tunneled ? info.innerSource : info.source;
+  key.destination = info.tunneled ? info.innerDestination : info.destination;
+  // route optimized packets belong to the flow of the home address
+  if (!info.tunneled && info.hasHomeAddress)
+    {
+      key.source = info.homeAddress;
+    }
+  if (!info.tunneled && info.hasRoutingHeader2)
+    {
+      key.destination = info.routingHomeAddress;
+    }
+  key.protocol = info.protocol;
+  key.sourcePort = 0;
+  key.destinationPort = 0;
+  const uint8_t *l4 = buffer + info.payloadOffset;
+  if ((info.protocol == PROTO_TCP || info.protocol == PROTO_UDP)
+      && info.payloadOffset + 4 <= size)
+    {
+      key.sourcePort = (l4[0] << 8) | l4[1];
+      key.destinationPort = (l4[2] << 8) | l4[3];
+    }
+  else if (info.protocol == PROTO_ICMPV6
+           && (info.icmpType == ICMPV6_ECHO_REQUEST || info.icmpType == ICMPV6_ECHO_REPLY)
+           && info.payloadOffset + 6 <= size)
+    {
+      key.sourcePort = (l4[4] << 8) | l4[5];
+    }
+  flow = GetFlowId (key);
+
+  // FNV-1a of the inner packet, without the hop limit routers decrement
+  innerOffset = info.innerOffset;
+  uint32_t end = std::min (size, info.payloadOffset + HASHED_PAYLOAD);
+  hash = 14695981039346656037ULL;
+  for (uint32_t i = innerOffset; i < end; i++)
+    {
+      if (i != innerOffset + IPV6_HOP_LIMIT)
+        {
+          hash = (hash ^ buffer[i]) * 1099511628211ULL;
+        }
+    }
+  return true;
+}
+
+void
+Mip6FlowMonitor::Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  FlowId flow;
+  uint64_t hash;
+  uint32_t innerOffset;
+  bool encapsulated;
+  if (!Classify (packet, flow, hash, innerOffset, encapsulated))
+    {
+      return;
+    }
+  Mip6FlowStats &stats = m_flowStats[flow];
+  uint32_t innerSize = packet->GetSize () - innerOffset;
+  Time now = Simulator::Now ();
+  if (sent)
+    {
+      if (encapsulated)
+        {
+          stats.tunneledPackets++;
+          stats.overheadBytes += innerOffset;
+        }
+      // a retransmission of a packet still in flight is the same packet
+      if (!m_inFlight.insert (std::make_pair (hash, InFlight ())).second)
+        {
+          return;
+        }
+      m_inFlight[hash].flow = flow;
+      m_inFlight[hash].sent = now;
+      if (stats.txPackets == 0)
+        {
+          stats.timeFirstTxPacket = now;
+        }
+      stats.timeLastTxPacket = now;
+      stats.txPackets++;
+      stats.txBytes += innerSize;
+      return;
+    }
+
+  std::map<uint64_t, InFlight>::iterator i = m_inFlight.find (hash);
+  if (i == m_inFlight.end () || i->second.flow != flow)
+    {
+      NS_LOG_LOGIC ("flow " << flow << ": received a packet not sent by an endpoint");
+      return;
+    }
+  Time delay = now - i->second.sent;
+  m_inFlight.erase (i);
+  if (stats.rxPackets == 0)
+    {
+      stats.timeFirstRxPacket = now;
+    }
+  else
+    {
+      stats.jitterSum += delay > stats.lastDelay ? delay - stats.lastDelay : stats.lastDelay - delay;
+    }
+  stats.lastDelay = delay;
+  stats.delaySum += delay;
+  stats.timeLastRxPacket = now;
+  stats.rxPackets++;
+  stats.rxBytes += innerSize;
+}
+
+void
+Mip6FlowMonitor::TunnelTap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  FlowId flow;
+  uint64_t hash;
+  uint32_t innerOffset;
+  bool encapsulated;
+  if (!Classify (packet, flow, hash, innerOffset, encapsulated) || !encapsulated)
+    {
+      return;
+    }
+  Mip6FlowStats &stats = m_flowStats[flow];
+  stats.tunneledPackets++;
+  stats.overheadBytes += innerOffset;
+}
+
+void
+Mip6FlowMonitor::CheckForLostPackets (void)
+{
+  Time now = Simulator::Now ();
+  for (std::map<uint64_t, InFlight>::iterator i = m_inFlight.begin (); i != m_inFlight.end (); )
+    {
+      if (now - i->second.sent > m_maxDelay)
+        {
+          m_flowStats[i->second.flow].lostPackets++;
+          m_inFlight.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+Mip6FlowMonitor::PeriodicCheckForLostPackets (void)
+{
+  CheckForLostPackets ();
+  m_checkEvent = Simulator::Schedule (m_maxDelay, &Mip6FlowMonitor::PeriodicCheckForLostPackets,
+                                      this);
+}
+
+const Mip6FlowMonitor::FlowStatsContainer &
+Mip6FlowMonitor::GetFlowStats (void)
+{
+  CheckForLostPackets ();
+  return m_flowStats;
+}
+
+Mip6FlowKey
+Mip6FlowMonitor::GetFlowKey (FlowId id) const
+{
+  std::map<FlowId, Mip6FlowKey>::const_iterator i = m_flowKeys.find (id);
+  NS_ABORT_MSG_IF (i == m_flowKeys.end (), "no flow " << id);
+  return i->second;
+}
+
+void
+Mip6FlowMonitor::Print (std::ostream &os)
+{
+  CheckForLostPackets ();
+  os << "flow,source,destination,protocol,source_port,destination_port,"
+     << "tx_packets,rx_packets,lost_packets,tx_bytes,rx_bytes,"
+     << "delay_ms,jitter_ms,throughput_kbps,tunneled_packets,overhead_bytes" << std::endl;
+  for (FlowStatsContainer::const_iterator i = m_flowStats.begin (); i != m_flowStats.end (); ++i)
+    {
+      const Mip6FlowKey &key = m_flowKeys[i->first];
+      const Mip6FlowStats &stats = i->second;
+      double delay = stats.rxPackets > 0
+        ? stats.delaySum.GetSeconds () * 1000 / stats.rxPackets : 0;
+      double jitter = stats.rxPackets > 1
+        ? stats.jitterSum.GetSeconds () * 1000 / (stats.rxPackets - 1) : 0;
+      double duration = (stats.timeLastRxPacket - stats.timeFirstRxPacket).GetSeconds ();
+      double throughput = duration > 0 ? stats.rxBytes * 8 / duration / 1000 : 0;
+      os << i->first << "," << key.source << "," << key.destination << ","
+         << (uint32_t)key.protocol << "," << key.sourcePort << "," << key.destinationPort << ","
+         << stats.txPackets << "," << stats.rxPackets << "," << stats.lostPackets << ","
+         << stats.txBytes << "," << stats.rxBytes << ","
+         << delay << "," << jitter << "," << throughput << ","
+         << stats.tunneledPackets << "," << stats.overheadBytes << std::endl;
+    }
+}
+
+} // namespace ns3
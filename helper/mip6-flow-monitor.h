@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6_FLOW_MONITOR_H
+#define MIP6_FLOW_MONITOR_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv6-address.h"
+#include "mip6-packet-parser.h"
+#include <map>
+#include <set>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \brief what identifies an inner flow: the addresses, protocol and
+ * ports of the end-to-end IPv6 packet, whatever tunnel carries it
+ */
+struct Mip6FlowKey
+{
+  Ipv6Address source;
+  Ipv6Address destination;
+  uint8_t protocol;
+  /// UDP/TCP ports; the echo identifier as source port for ICMPv6
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+};
+
+bool operator < (const Mip6FlowKey &a, const Mip6FlowKey &b);
+
+/**
+ * \brief statistics of one inner flow, named after those of
+ * FlowMonitor::FlowStats
+ */
+struct Mip6FlowStats
+{
+  Mip6FlowStats ();
+
+  Time timeFirstTxPacket;
+  Time timeLastTxPacket;
+  Time timeFirstRxPacket;
+  Time timeLastRxPacket;
+  /// sum of the delays of the received packets
+  Time delaySum;
+  /// sum of the delay variations between consecutive received packets
+  Time jitterSum;
+  Time lastDelay;
+  /// sizes of the inner IPv6 packets
+  uint64_t txBytes;
+  uint64_t rxBytes;
+  uint32_t txPackets;
+  uint32_t rxPackets;
+  /// packets not received within MaxDelay
+  uint32_t lostPackets;
+  /// packets of the flow sent encapsulated, once per encapsulation
+  uint32_t tunneledPackets;
+  /// outer headers added by the encapsulations, IPv6 or IPv4 (and UDP)
+  uint64_t overheadBytes;
+};
+
+/**
+ * \brief per inner flow delay, jitter, loss, throughput and tunnel
+ * overhead
+ *
+ * FlowMonitor classifies the packets at the ns-3 IP layer, which DCE
+ * nodes running the Linux stack do not have, and would anyway see all
+ * the traffic of a MR to HA tunnel as one flow. This monitor taps the
+ * devices instead and classifies each packet by its inner IPv6 packet:
+ * native, IPv6-in-IPv6 and DSMIP6 (IPv6 over IPv4 or UDP/IPv4) packets
+ * of a flow are accounted together.
+ *
+ * Packets are sent and received by endpoints (Install ()): CN, MNN and
+ * MN. Simulated kernels copy packets, so tags do not survive the path: a
+ * packet is recognized at the receiver by a hash of its inner IPv6
+ * header (hop limit aside) and first payload bytes, so packets equal
+ * byte for byte are one packet: numbered traffic, as ping6, TCP and the
+ * usual generators send, is needed. Both ends of a flow must be
+ * installed, or all its packets end up lost. Tunnel ends which
+ * are not endpoints, HA and MR, are watched by WatchTunnel () for the
+ * encapsulation overhead only; overhead is accounted where a packet is
+ * sent encapsulated, so once per encapsulation.
+ *
+ * Mip6dHelper::EnableFlowMonitor () watches the nodes it installs; MNNs
+ * and CNs without mip6d are left to Install ().
+ */
+class Mip6FlowMonitor : public Object
+{
+public:
+  typedef uint32_t FlowId;
+  typedef std::map<FlowId, Mip6FlowStats> FlowStatsContainer;
+
+  static TypeId GetTypeId (void);
+
+  Mip6FlowMonitor ();
+
+  /**
+   * \brief Monitor the flows a node sends and receives
+   * \param node an endpoint, which does not forward packets
+   */
+  void Install (Ptr<Node> node);
+  /**
+   * \brief Monitor the flows of some nodes
+   * \param nodes endpoints
+   */
+  void Install (NodeContainer nodes);
+  /**
+   * \brief Account the packets a forwarding node encapsulates
+   * \param node a HA, MR or LMA
+   */
+  void WatchTunnel (Ptr<Node> node);
+
+  /**
+   * \brief Count as lost the packets sent more than MaxDelay ago and
+   * not received yet
+   */
+  void CheckForLostPackets (void);
+
+  /**
+   * \returns the statistics of every flow, after CheckForLostPackets ()
+   */
+  const FlowStatsContainer &GetFlowStats (void);
+  /**
+   * \returns the key of a flow
+   */
+  Mip6FlowKey GetFlowKey (FlowId id) const;
+  /**
+   * \brief Print one CSV line per flow: key, counters, mean delay and
+   * jitter (ms), throughput (kbit/s) and overhead
+   */
+  void Print (std::ostream &os);
+
+private:
+  struct InFlight
+  {
+    FlowId flow;
+    Time sent;
+  };
+
+  virtual void DoDispose (void);
+  void Start (void);
+  void PeriodicCheckForLostPackets (void);
+  void Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+  void TunnelTap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+  // parse the packet and find its inner flow, false for signaling and
+  // packets of no flow
+  bool Classify (Ptr<const Packet> packet, FlowId &flow, uint64_t &hash,
+                 uint32_t &innerOffset, bool &encapsulated);
+  FlowId GetFlowId (const Mip6FlowKey &key);
+
+  uint16_t m_dsmip6Port;
+  Time m_maxDelay;
+  EventId m_checkEvent;
+  std::set<uint32_t> m_endpoints;
+  std::set<uint32_t> m_tunnels;
+  std::map<Mip6FlowKey, FlowId> m_flowIds;
+  std::map<FlowId, Mip6FlowKey> m_flowKeys;
+  FlowStatsContainer m_flowStats;
+  // hash of a packet sent by an endpoint and not received yet
+  std::map<uint64_t, InFlight> m_inFlight;
+};
+
+} // namespace ns3
+
+#endif /* MIP6_FLOW_MONITOR_H */
@@ -0,0 +1,425 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6-goodput.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/type-id.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6Goodput");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6GoodputSource);
+NS_OBJECT_ENSURE_REGISTERED (Mip6GoodputSink);
+
+enum
+{
+  // sequence number and send time
+  RECORD_HEADER_SIZE = 12
+};
+
+std::ostream &
+operator << (std::ostream &os, const Mip6Interruption &interruption)
+{
+  os << "start=" << interruption.start.GetSeconds ()
+     << "s duration=" << (interruption.end - interruption.start).GetSeconds () * 1000 << "ms"
+     << " lost=" << interruption.lost
+     << " reordered=" << interruption.reordered
+     << " recovery=";
+  if (interruption.recovery < Seconds (0))
+    {
+      os << "-";
+    }
+  else
+    {
+      os << interruption.recovery.GetSeconds () * 1000 << "ms";
+    }
+  return os;
+}
+
+TypeId
+Mip6GoodputSource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6GoodputSource")
+    .SetParent<Application> ()
+    .AddConstructor<Mip6GoodputSource> ()
+    .AddAttribute ("Protocol", "The type of socket to send over.",
+                   TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&Mip6GoodputSource::m_tid),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("Remote", "The address of the Mip6GoodputSink.",
+                   AddressValue (),
+                   MakeAddressAccessor (&Mip6GoodputSource::m_remote),
+                   MakeAddressChecker ())
+    .AddAttribute ("PacketSize", "Bytes of a record, its header included.",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&Mip6GoodputSource::m_packetSize),
+                   MakeUintegerChecker<uint32_t> (RECORD_HEADER_SIZE))
+    .AddAttribute ("Interval", "Time between two records.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&Mip6GoodputSource::m_interval),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+Mip6GoodputSource::Mip6GoodputSource ()
+  : m_packetSize (512),
+    m_interval (MilliSeconds (10)),
+    m_stream (false),
+    m_sequence (0)
+{
+}
+
+Mip6GoodputSource::~Mip6GoodputSource ()
+{
+}
+
+void
+Mip6GoodputSource::DoDispose (void)
+{
+  m_socket = 0;
+  Application::DoDispose ();
+}
+
+uint32_t
+Mip6GoodputSource::GetNSent (void) const
+{
+  return m_sequence;
+}
+
+void
+Mip6GoodputSource::StartApplication (void)
+{
+  m_socket = Socket::CreateSocket (GetNode (), m_tid);
+  m_stream = m_socket->GetSocketType () == Socket::NS3_SOCK_STREAM;
+  m_socket->Bind6 ();
+  m_socket->Connect (m_remote);
+  m_socket->SetSendCallback (MakeCallback (&Mip6GoodputSource::Flush, this));
+  SendRecord ();
+}
+
+void
+Mip6GoodputSource::StopApplication (void)
+{
+  m_sendEvent.Cancel ();
+  if (m_socket)
+    {
+      m_socket->Close ();
+      m_socket = 0;
+    }
+}
+
+void
+Mip6GoodputSource::SendRecord (void)
+{
+  std::vector<uint8_t> record (m_packetSize, 0);
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  for (int i = 0; i < 4; i++)
+    {
+      record[i] = m_sequence >> (24 - 8 * i);
+    }
+  for (int i = 0; i < 8; i++)
+    {
+      record[4 + i] = now >> (56 - 8 * i);
+    }
+  m_sequence++;
+  if (m_stream)
+    {
+      m_pending.insert (m_pending.end (), record.begin (), record.end ());
+      Flush (m_socket, m_socket->GetTxAvailable ());
+    }
+  else if (m_socket->Send (Create<Packet> (&record[0], record.size ())) < 0)
+    {
+      NS_LOG_LOGIC ("record " << m_sequence - 1 << " not sent");
+    }
+  m_sendEvent = Simulator::Schedule (m_interval, &Mip6GoodputSource::SendRecord, this);
+}
+
+void
+Mip6GoodputSource::Flush (Ptr<Socket> socket, uint32_t available)
+{
+  if (!m_stream || m_pending.empty () || available == 0)
+    {
+      return;
+    }
+  uint32_t size = std::min<uint32_t> (available, m_pending.size ());
+  int sent = socket->Send (Create<Packet> (&m_pending[0], size));
+  if (sent > 0)
+    {
+      m_pending.erase (m_pending.begin (), m_pending.begin () + sent);
+    }
+}
+
+TypeId
+Mip6GoodputSink::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6GoodputSink")
+    .SetParent<Application> ()
+    .AddConstructor<Mip6GoodputSink> ()
+    .AddAttribute ("Protocol", "The type of socket to receive on.",
+                   TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&Mip6GoodputSink::m_tid),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("Local", "The address to listen on.",
+                   AddressValue (),
+                   MakeAddressAccessor (&Mip6GoodputSink::m_local),
+                   MakeAddressChecker ())
+    .AddAttribute ("PacketSize", "Bytes of a record, as sent by the source.",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&Mip6GoodputSink::m_packetSize),
+                   MakeUintegerChecker<uint32_t> (RECORD_HEADER_SIZE))
+    .AddAttribute ("GapThreshold", "A pause longer than this between two records is an interruption.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&Mip6GoodputSink::m_gapThreshold),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Rx", "A record was received: its sequence number and delay.",
+                     MakeTraceSourceAccessor (&Mip6GoodputSink::m_rxTrace),
+                     "ns3::Mip6GoodputSink::RxCallback")
+    .AddTraceSource ("Interruption", "The flow recovered from an interruption, "
+                     "or was interrupted again before.",
+                     MakeTraceSourceAccessor (&Mip6GoodputSink::m_interruptionTrace),
+                     "ns3::Mip6GoodputSink::InterruptionCallback")
+  ;
+  return tid;
+}
+
+Mip6GoodputSink::Mip6GoodputSink ()
+  : m_packetSize (512),
+    m_gapThreshold (MilliSeconds (100)),
+    m_received (0),
+    m_nextSequence (0),
+    m_reordered (0),
+    m_totalRx (0),
+    m_open (false)
+{
+}
+
+Mip6GoodputSink::~Mip6GoodputSink ()
+{
+}
+
+void
+Mip6GoodputSink::DoDispose (void)
+{
+  m_socket = 0;
+  m_connection = 0;
+  Application::DoDispose ();
+}
+
+void
+Mip6GoodputSink::StartApplication (void)
+{
+  m_socket = Socket::CreateSocket (GetNode (), m_tid);
+  m_socket->Bind (m_local);
+  m_socket->SetRecvCallback (MakeCallback (&Mip6GoodputSink::Receive, this));
+  if (m_socket->GetSocketType () == Socket::NS3_SOCK_STREAM)
+    {
+      m_socket->Listen ();
+      m_socket->SetAcceptCallback (MakeCallback (&Mip6GoodputSink::Accept, this),
+                                   MakeCallback (&Mip6GoodputSink::Accepted, this));
+    }
+}
+
+void
+Mip6GoodputSink::StopApplication (void)
+{
+  if (m_connection)
+    {
+      m_connection->Close ();
+      m_connection = 0;
+    }
+  if (m_socket)
+    {
+      m_socket->Close ();
+      m_socket = 0;
+    }
+}
+
+bool
+Mip6GoodputSink::Accept (Ptr<Socket> socket, const Address &from)
+{
+  return !m_connection;
+}
+
+void
+Mip6GoodputSink::Accepted (Ptr<Socket> socket, const Address &from)
+{
+  m_connection = socket;
+  m_connection->SetRecvCallback (MakeCallback (&Mip6GoodputSink::Receive, this));
+}
+
+void
+Mip6GoodputSink::Receive (Ptr<Socket> socket)
+{
+  bool stream = socket->GetSocketType () == Socket::NS3_SOCK_STREAM;
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      uint32_t size = packet->GetSize ();
+      m_totalRx += size;
+      if (!stream)
+        {
+          if (size < RECORD_HEADER_SIZE)
+            {
+              continue;
+            }
+          uint8_t header[RECORD_HEADER_SIZE];
+          packet->CopyData (header, sizeof (header));
+          ReceiveRecord (header);
+          continue;
+        }
+      uint32_t offset = m_partial.size ();
+      m_partial.resize (offset + size);
+      packet->CopyData (&m_partial[offset], size);
+      uint32_t records = m_partial.size () / m_packetSize;
+      for (uint32_t i = 0; i < records; i++)
+        {
+          ReceiveRecord (&m_partial[i * m_packetSize]);
+        }
+      m_partial.erase (m_partial.begin (), m_partial.begin () + records * m_packetSize);
+    }
+}
+
+void
+Mip6GoodputSink::ReceiveRecord (const uint8_t *record)
+{
+  uint32_t sequence = 0;
+  uint64_t sent = 0;
+  for (int i = 0; i < 4; i++)
+    {
+      sequence = (sequence << 8) | record[i];
+    }
+  for (int i = 0; i < 8; i++)
+    {
+      sent = (sent << 8) | record[4 + i];
+    }
+  Time now = Simulator::Now ();
+  Time delay = now - NanoSeconds (sent);
+  m_received++;
+  m_rxTrace (sequence, delay);
+
+  if (m_received > 1 && now - m_lastRx > m_gapThreshold)
+    {
+      if (m_open)
+        {
+          // interrupted again before recovering: keep the delay of
+          // before the first outage as reference
+          m_interruptionTrace (m_interruptions.back ());
+        }
+      else
+        {
+          m_baseDelay = m_lastDelay;
+        }
+      Mip6Interruption interruption;
+      interruption.start = m_lastRx;
+      interruption.end = now;
+      interruption.lost = 0;
+      interruption.reordered = 0;
+      interruption.recovery = Seconds (-1);
+      m_interruptions.push_back (interruption);
+      m_open = true;
+    }
+  m_lastRx = now;
+  m_lastDelay = delay;
+
+  if (sequence >= m_nextSequence)
+    {
+      for (uint32_t s = m_nextSequence; s < sequence; s++)
+        {
+          m_missing.insert (s);
+        }
+      if (m_open)
+        {
+          m_interruptions.back ().lost += sequence - m_nextSequence;
+        }
+      m_nextSequence = sequence + 1;
+    }
+  else if (m_missing.erase (sequence) > 0)
+    {
+      m_reordered++;
+      if (m_open)
+        {
+          Mip6Interruption &interruption = m_interruptions.back ();
+          interruption.reordered++;
+          if (interruption.lost > 0)
+            {
+              interruption.lost--;
+            }
+        }
+    }
+
+  if (m_open && delay <= m_baseDelay + m_gapThreshold)
+    {
+      Mip6Interruption &interruption = m_interruptions.back ();
+      interruption.recovery = now - interruption.end;
+      m_open = false;
+      NS_LOG_INFO ("interruption " << interruption);
+      m_interruptionTrace (interruption);
+    }
+}
+
+const std::vector<Mip6Interruption> &
+Mip6GoodputSink::GetInterruptions (void) const
+{
+  return m_interruptions;
+}
+
+uint32_t
+Mip6GoodputSink::GetNReceived (void) const
+{
+  return m_received;
+}
+
+uint32_t
+Mip6GoodputSink::GetNLost (void) const
+{
+  return m_missing.size ();
+}
+
+uint32_t
+Mip6GoodputSink::GetNReordered (void) const
+{
+  return m_reordered;
+}
+
+uint64_t
+Mip6GoodputSink::GetTotalRx (void) const
+{
+  return m_totalRx;
+}
+
+void
+Mip6GoodputSink::Print (std::ostream &os) const
+{
+  os << "start,duration,lost,reordered,recovery" << std::endl;
+  for (std::vector<Mip6Interruption>::const_iterator i = m_interruptions.begin ();
+       i != m_interruptions.end (); ++i)
+    {
+      os << i->start.GetSeconds () << "," << (i->end - i->start).GetSeconds () << ","
+         << i->lost << "," << i->reordered << "," << i->recovery.GetSeconds () << std::endl;
+    }
+}
+
+} // namespace ns3
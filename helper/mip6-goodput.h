@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6_GOODPUT_H
+#define MIP6_GOODPUT_H
+
+#include "ns3/application.h"
+#include "ns3/socket.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include <ostream>
+#include <vector>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \brief one outage of a goodput flow, as seen by Mip6GoodputSink
+ */
+struct Mip6Interruption
+{
+  /// arrival of the last record before the outage
+  Time start;
+  /// arrival of the first record after it
+  Time end;
+  /// records never received, skipped over at or after the outage
+  uint32_t lost;
+  /// records received after a later one
+  uint32_t reordered;
+  /// from end until records arrive as late as before the outage again,
+  /// i.e. the backlog is drained; negative while not recovered
+  Time recovery;
+};
+
+std::ostream & operator << (std::ostream &os, const Mip6Interruption &interruption);
+
+/**
+ * \brief send sequence-numbered, timestamped records at a constant rate
+ *
+ * Each record is PacketSize bytes: a 32 bit sequence number and the 64
+ * bit send time in nanoseconds, network byte order, then padding. Over
+ * UDP a record is a datagram; over TCP records are written back to back
+ * on the stream, and what the socket does not take yet is kept and sent
+ * as soon as it has room, so the source never drops records.
+ *
+ * The socket type is given by Protocol, UDP of the node's stack by
+ * default, as for OnOffApplication. On DCE nodes running the Linux stack,
+ * set the Linux socket factories (e.g. ns3::LinuxUdp6SocketFactory,
+ * ns3::LinuxTcp6SocketFactory), which need LinuxStackHelper::Install ()
+ * on the node.
+ */
+class Mip6GoodputSource : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6GoodputSource ();
+  virtual ~Mip6GoodputSource ();
+
+  /**
+   * \returns the number of records generated
+   */
+  uint32_t GetNSent (void) const;
+
+private:
+  virtual void DoDispose (void);
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void SendRecord (void);
+  void Flush (Ptr<Socket> socket, uint32_t available);
+
+  TypeId m_tid;
+  Address m_remote;
+  uint32_t m_packetSize;
+  Time m_interval;
+
+  Ptr<Socket> m_socket;
+  bool m_stream;
+  // bytes of records the stream socket did not take yet
+  std::vector<uint8_t> m_pending;
+  uint32_t m_sequence;
+  EventId m_sendEvent;
+};
+
+/**
+ * \brief receive the records of a Mip6GoodputSource and time its outages
+ *
+ * An outage is a pause of more than GapThreshold between two records.
+ * For each, the sink counts the records lost and reordered around it and
+ * the recovery time: records sent during the outage may still come late,
+ * e.g. retransmitted by TCP, and the flow has recovered its full goodput
+ * when the delay of a record is back within GapThreshold of the delay
+ * before the outage. An interruption is reported by the Interruption
+ * trace once recovered.
+ *
+ * One source per sink: TCP records are reassembled from the first
+ * accepted connection.
+ */
+class Mip6GoodputSink : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6GoodputSink ();
+  virtual ~Mip6GoodputSink ();
+
+  /**
+   * \returns the interruptions so far, the last one possibly not
+   * recovered yet
+   */
+  const std::vector<Mip6Interruption> &GetInterruptions (void) const;
+  /**
+   * \returns the number of records received
+   */
+  uint32_t GetNReceived (void) const;
+  /**
+   * \returns the number of records lost, over the whole flow
+   */
+  uint32_t GetNLost (void) const;
+  /**
+   * \returns the number of records received out of order
+   */
+  uint32_t GetNReordered (void) const;
+  /**
+   * \returns the number of bytes received
+   */
+  uint64_t GetTotalRx (void) const;
+
+  /**
+   * \brief Print one CSV line per interruption: start, duration, lost,
+   * reordered and recovery, in seconds
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  virtual void DoDispose (void);
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  bool Accept (Ptr<Socket> socket, const Address &from);
+  void Accepted (Ptr<Socket> socket, const Address &from);
+  void Receive (Ptr<Socket> socket);
+  void ReceiveRecord (const uint8_t *record);
+
+  TypeId m_tid;
+  Address m_local;
+  uint32_t m_packetSize;
+  Time m_gapThreshold;
+
+  Ptr<Socket> m_socket;
+  Ptr<Socket> m_connection;
+  // bytes of the record being reassembled from the stream
+  std::vector<uint8_t> m_partial;
+  uint32_t m_received;
+  uint32_t m_nextSequence;
+  // sequence numbers skipped over, which may still come
+  std::set<uint32_t> m_missing;
+  uint32_t m_reordered;
+  uint64_t m_totalRx;
+  Time m_lastRx;
+  Time m_lastDelay;
+  // delay before the open interruption
+  Time m_baseDelay;
+  bool m_open;
+  std::vector<Mip6Interruption> m_interruptions;
+
+  TracedCallback<uint32_t, Time> m_rxTrace;
+  TracedCallback<const Mip6Interruption &> m_interruptionTrace;
+};
+
+} // namespace ns3
+
+#endif /* MIP6_GOODPUT_H */
@@ -0,0 +1,389 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6-packet-parser.h"
+#include "ns3/pointer.h"
+#include <algorithm>
+
+namespace ns3 {
+
+enum
+{
+  IPV6_HEADER_SIZE = 40,
+  // enough for an outer and an inner header, a few extension headers
+  // and the Mobility Header fields we read
+  PARSE_BYTES = 256,
+  NH_HOPOPTS = 0,
+  NH_IPV6 = 41,
+  NH_ROUTING = 43,
+  NH_FRAGMENT = 44,
+  NH_ICMPV6 = 58,
+  NH_NONE = 59,
+  NH_DSTOPTS = 60,
+  NH_MH = 135,
+  OPT_PAD1 = 0,
+  OPT_HOME_ADDRESS = 201,
+  IPV4_HEADER_SIZE = 20,
+  IPV4_PROTO_UDP = 17,
+  UDP_HEADER_SIZE = 8,
+  MH_FIXED_SIZE = 12,
+  MHOPT_HOME_NETWORK_PREFIX = 22,
+  // the largest link-layer header a tapped frame has, Ethernet with
+  // LLC/SNAP, and the IP header bytes up to its length field
+  FRAME_BYTES = 22 + 6
+};
+
+static uint16_t
+ReadU16 (const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+bool
+Mip6PacketParser::Parse (Ptr<const Packet> packet, Mip6PacketInfo &info)
+{
+  uint8_t buffer[PARSE_BYTES];
+  uint32_t size = packet->CopyData (buffer, sizeof (buffer));
+  return Parse (buffer, size, info);
+}
+
+bool
+Mip6PacketParser::Parse (const uint8_t *buffer, uint32_t size, Mip6PacketInfo &info)
+{
+  info.tunneled = false;
+  info.innerOffset = 0;
+  info.hasHomeAddress = false;
+  info.hasRoutingHeader2 = false;
+  info.hasMobilityHeader = false;
+  info.protocol = NH_NONE;
+  info.payloadOffset = size;
+  info.mhType = 0;
+  info.sequence = 0;
+  info.status = 0;
+  info.lifetime = 0;
+  info.hasHomeNetworkPrefix = false;
+  info.icmpType = 0;
+
+  if (size < IPV6_HEADER_SIZE || (buffer[0] >> 4) != 6)
+    {
+      return false;
+    }
+  info.source = Ipv6Address::Deserialize (buffer + 8);
+  info.destination = Ipv6Address::Deserialize (buffer + 24);
+
+  uint8_t next = buffer[6];
+  uint32_t offset = IPV6_HEADER_SIZE;
+  while (true)
+    {
+      switch (next)
+        {
+        case NH_HOPOPTS:
+        case NH_DSTOPTS:
+        case NH_ROUTING:
+          {
+            if (offset + 8 > size)
+              {
+                return true;
+              }
+            uint32_t length = (buffer[offset + 1] + 1) * 8;
+            if (offset + length > size)
+              {
+                return true;
+              }
+            if (next == NH_ROUTING && buffer[offset + 2] == 2 && length >= 24)
+              {
+                info.hasRoutingHeader2 = true;
+                info.routingHomeAddress = Ipv6Address::Deserialize (buffer + offset + 8);
+              }
+            else if (next == NH_DSTOPTS)
+              {
+                uint32_t opt = offset + 2;
+                while (opt + 2 <= offset + length)
+                  {
+                    if (buffer[opt] == OPT_PAD1)
+                      {
+                        opt++;
+                        continue;
+                      }
+                    if (buffer[opt] == OPT_HOME_ADDRESS && buffer[opt + 1] == 16
+                        && opt + 18 <= offset + length)
+                      {
+                        info.hasHomeAddress = true;
+                        info.homeAddress = Ipv6Address::Deserialize (buffer + opt + 2);
+                      }
+                    opt += 2 + buffer[opt + 1];
+                  }
+              }
+            next = buffer[offset];
+            offset += length;
+          }
+          break;
+        case NH_IPV6:
+          if (info.tunneled || offset + IPV6_HEADER_SIZE > size)
+            {
+              // do not look further than one level of encapsulation
+              info.protocol = next;
+              info.payloadOffset = offset;
+              return true;
+            }
+          info.tunneled = true;
+          info.innerOffset = offset;
+          info.innerSource = Ipv6Address::Deserialize (buffer + offset + 8);
+          info.innerDestination = Ipv6Address::Deserialize (buffer + offset + 24);
+          next = buffer[offset + 6];
+          offset += IPV6_HEADER_SIZE;
+          break;
+        case NH_MH:
+          info.protocol = next;
+          info.payloadOffset = offset;
+          if (offset + 6 > size)
+            {
+              return true;
+            }
+          info.hasMobilityHeader = true;
+          info.mhType = buffer[offset + 2];
+          if (info.mhType == Mip6PacketInfo::MH_BU && offset + 12 <= size)
+            {
+              info.sequence = ReadU16 (buffer + offset + 6);
+              info.lifetime = ReadU16 (buffer + offset + 10);
+            }
+          else if (info.mhType == Mip6PacketInfo::MH_BA && offset + 12 <= size)
+            {
+              info.status = buffer[offset + 6];
+              info.sequence = ReadU16 (buffer + offset + 8);
+              info.lifetime = ReadU16 (buffer + offset + 10);
+            }
+          if (info.mhType == Mip6PacketInfo::MH_BU || info.mhType == Mip6PacketInfo::MH_BA)
+            {
+              // mobility options follow the fixed part of both messages
+              uint32_t end = std::min (offset + (buffer[offset + 1] + 1) * 8, size);
+              uint32_t opt = offset + MH_FIXED_SIZE;
+              while (opt + 2 <= end)
+                {
+                  if (buffer[opt] == OPT_PAD1)
+                    {
+                      opt++;
+                      continue;
+                    }
+                  if (buffer[opt] == MHOPT_HOME_NETWORK_PREFIX && buffer[opt + 1] == 18
+                      && opt + 20 <= end)
+                    {
+                      info.hasHomeNetworkPrefix = true;
+                      info.homeNetworkPrefix = Ipv6Address::Deserialize (buffer + opt + 4);
+                    }
+                  opt += 2 + buffer[opt + 1];
+                }
+            }
+          return true;
+        case NH_ICMPV6:
+          info.protocol = next;
+          info.payloadOffset = offset;
+          if (offset < size)
+            {
+              info.icmpType = buffer[offset];
+            }
+          if ((info.icmpType == Mip6PacketInfo::ND_NEIGHBOR_SOLICITATION
+               || info.icmpType == Mip6PacketInfo::ND_NEIGHBOR_ADVERTISEMENT)
+              && offset + 24 <= size)
+            {
+              info.ndTarget = Ipv6Address::Deserialize (buffer + offset + 8);
+            }
+          return true;
+        case NH_FRAGMENT:
+        default:
+          info.protocol = next;
+          info.payloadOffset = offset;
+          return true;
+        }
+    }
+}
+
+bool
+Mip6PacketParser::ParseIpv4 (const uint8_t *buffer, uint32_t size, uint16_t udpPort,
+                             Mip6PacketInfo &info)
+{
+  uint32_t offset = size < IPV4_HEADER_SIZE ? 0 : (buffer[0] & 0x0f) * 4;
+  if (offset < IPV4_HEADER_SIZE || (buffer[0] >> 4) != 4 || offset > size)
+    {
+      // only resets info
+      Parse (buffer, 0, info);
+      return false;
+    }
+  if (buffer[9] == IPV4_PROTO_UDP && offset + UDP_HEADER_SIZE <= size
+      && (ReadU16 (buffer + offset) == udpPort || ReadU16 (buffer + offset + 2) == udpPort))
+    {
+      offset += UDP_HEADER_SIZE;
+    }
+  else if (buffer[9] != NH_IPV6)
+    {
+      Parse (buffer, 0, info);
+      return false;
+    }
+  if (!Parse (buffer + offset, size - offset, info))
+    {
+      return false;
+    }
+  info.payloadOffset += offset;
+  info.innerOffset = info.tunneled ? info.innerOffset + offset : offset;
+  return true;
+}
+
+static void
+RxTap (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, Ptr<const Packet> packet,
+       uint16_t protocol, const Address &from, const Address &to,
+       NetDevice::PacketType type)
+{
+  tap (device, packet, false);
+}
+
+static bool
+IsTapped (uint8_t version, bool ipv4)
+{
+  return (version >> 4) == 6 || (ipv4 && (version >> 4) == 4);
+}
+
+static void
+TxTap (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, bool ipv4,
+       Ptr<const Packet> packet)
+{
+  uint8_t version;
+  if (packet->CopyData (&version, 1) == 1 && IsTapped (version, ipv4))
+    {
+      tap (device, packet, true);
+    }
+}
+
+// Hand the tap the IP packet which follows a link-layer header of
+// headerSize bytes, without the padding and trailer of the frame.
+static void
+TapFrame (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, bool ipv4,
+          Ptr<const Packet> packet, const uint8_t *frame, uint32_t size,
+          uint32_t headerSize, uint16_t ethertype)
+{
+  if (size < headerSize + 6)
+    {
+      return;
+    }
+  const uint8_t *ip = frame + headerSize;
+  uint32_t length;
+  if (ethertype == 0x86DD && (ip[0] >> 4) == 6)
+    {
+      length = IPV6_HEADER_SIZE + ReadU16 (ip + 4);
+    }
+  else if (ipv4 && ethertype == 0x0800 && (ip[0] >> 4) == 4)
+    {
+      length = ReadU16 (ip + 2);
+    }
+  else
+    {
+      return;
+    }
+  length = std::min (length, packet->GetSize () - headerSize);
+  tap (device, packet->CreateFragment (headerSize, length), true);
+}
+
+// CsmaNetDevice adds its Ethernet header and trailer before MacTx
+static void
+CsmaTxTap (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, bool ipv4,
+           Ptr<const Packet> packet)
+{
+  uint8_t frame[FRAME_BYTES];
+  uint32_t size = packet->CopyData (frame, FRAME_BYTES);
+  if (size < 14)
+    {
+      return;
+    }
+  uint16_t type = ReadU16 (frame + 12);
+  if (type >= 0x0600)
+    {
+      TapFrame (tap, device, ipv4, packet, frame, size, 14, type);
+    }
+  else if (size >= 22 && frame[14] == 0xaa && frame[15] == 0xaa && frame[16] == 0x03)
+    {
+      // LLC encapsulation mode: a length, then LLC/SNAP
+      TapFrame (tap, device, ipv4, packet, frame, size, 22, ReadU16 (frame + 20));
+    }
+}
+
+// PointToPointNetDevice adds its PPP header before MacTx
+static void
+PppTxTap (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, bool ipv4,
+          Ptr<const Packet> packet)
+{
+  uint8_t frame[FRAME_BYTES];
+  uint32_t size = packet->CopyData (frame, FRAME_BYTES);
+  if (size < 2)
+    {
+      return;
+    }
+  uint16_t protocol = ReadU16 (frame);
+  TapFrame (tap, device, ipv4, packet, frame, size, 2,
+            protocol == 0x0057 ? 0x86DD : protocol == 0x0021 ? 0x0800 : 0);
+}
+
+// WifiNetDevice hands its Mac the packet with an LLC/SNAP header already
+static void
+WifiTxTap (Mip6PacketTap::TapCallback tap, Ptr<NetDevice> device, bool ipv4,
+           Ptr<const Packet> packet)
+{
+  uint8_t frame[FRAME_BYTES];
+  uint32_t size = packet->CopyData (frame, FRAME_BYTES);
+  if (size >= 8)
+    {
+      TapFrame (tap, device, ipv4, packet, frame, size, 8, ReadU16 (frame + 6));
+    }
+}
+
+void
+Mip6PacketTap::Install (Ptr<Node> node, TapCallback tap, bool rx, bool tx, bool ipv4)
+{
+  if (rx)
+    {
+      node->RegisterProtocolHandler (MakeBoundCallback (&RxTap, tap), 0x86DD, 0, false);
+      if (ipv4)
+        {
+          node->RegisterProtocolHandler (MakeBoundCallback (&RxTap, tap), 0x0800, 0, false);
+        }
+    }
+  for (uint32_t i = 0; tx && i < node->GetNDevices (); i++)
+    {
+      Ptr<NetDevice> device = node->GetDevice (i);
+      std::string type = device->GetInstanceTypeId ().GetName ();
+      if (type == "ns3::CsmaNetDevice")
+        {
+          device->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&CsmaTxTap, tap, device, ipv4));
+          continue;
+        }
+      if (type == "ns3::PointToPointNetDevice")
+        {
+          device->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&PppTxTap, tap, device, ipv4));
+          continue;
+        }
+      if (device->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&TxTap, tap, device, ipv4)))
+        {
+          continue;
+        }
+      PointerValue mac;
+      if (device->GetAttributeFailSafe ("Mac", mac) && mac.Get<Object> ())
+        {
+          mac.Get<Object> ()->TraceConnectWithoutContext ("MacTx",
+                                                         MakeBoundCallback (&WifiTxTap, tap, device, ipv4));
+        }
+    }
+}
+
+} // namespace ns3
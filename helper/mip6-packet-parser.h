@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6_PACKET_PARSER_H
+#define MIP6_PACKET_PARSER_H
+
+#include "ns3/packet.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/callback.h"
+
+namespace ns3 {
+
+/**
+ * \brief what a Mobile IPv6 observer needs to know about an IPv6 packet
+ *
+ * Filled by Mip6PacketParser from the raw bytes of the packet, without
+ * deserializing ns-3 headers. Only the fields relevant to the packet are
+ * meaningful.
+ */
+struct Mip6PacketInfo
+{
+  /// Mobility Header types (RFC 6275, RFC 3963, RFC 5213)
+  enum MhType
+  {
+    MH_BRR = 0,
+    MH_HOTI = 1,
+    MH_COTI = 2,
+    MH_HOT = 3,
+    MH_COT = 4,
+    MH_BU = 5,
+    MH_BA = 6,
+    MH_BE = 7
+  };
+  /// ICMPv6 types of Neighbor Discovery (RFC 4861)
+  enum NdType
+  {
+    ND_ROUTER_SOLICITATION = 133,
+    ND_ROUTER_ADVERTISEMENT = 134,
+    ND_NEIGHBOR_SOLICITATION = 135,
+    ND_NEIGHBOR_ADVERTISEMENT = 136
+  };
+
+  Ipv6Address source;
+  Ipv6Address destination;
+  /// packet is IPv6-in-IPv6; source/destination are the outer addresses
+  bool tunneled;
+  /// offset of the encapsulated IPv6 packet: the inner header when
+  /// tunneled, the IPv6 packet after ParseIpv4 (), 0 otherwise
+  uint32_t innerOffset;
+  Ipv6Address innerSource;
+  Ipv6Address innerDestination;
+  /// packet carries a Home Address destination option
+  bool hasHomeAddress;
+  Ipv6Address homeAddress;
+  /// packet carries a type 2 routing header
+  bool hasRoutingHeader2;
+  Ipv6Address routingHomeAddress;
+  /// upper-layer protocol after the extension headers, 59 if none
+  uint8_t protocol;
+  /// offset of the upper-layer header in the packet
+  uint32_t payloadOffset;
+  /// packet carries a Mobility Header
+  bool hasMobilityHeader;
+  uint8_t mhType;
+  /// BU and BA sequence number
+  uint16_t sequence;
+  /// BA status
+  uint8_t status;
+  /// BU and BA lifetime, in units of 4 seconds
+  uint16_t lifetime;
+  /// BU or BA carries a Home Network Prefix option (Proxy Mobile IPv6)
+  bool hasHomeNetworkPrefix;
+  Ipv6Address homeNetworkPrefix;
+  /// ICMPv6 type, when protocol is 58
+  uint8_t icmpType;
+  /// Neighbor Solicitation and Advertisement target
+  Ipv6Address ndTarget;
+};
+
+/**
+ * \brief classify Mobile IPv6 signaling and tunneled traffic
+ */
+class Mip6PacketParser
+{
+public:
+  /**
+   * \param packet a packet starting with its IPv6 header
+   * \param info filled with what was found
+   * \returns false if the packet is not an IPv6 packet or is truncated
+   * before its first header
+   */
+  static bool Parse (Ptr<const Packet> packet, Mip6PacketInfo &info);
+
+  /**
+   * \param buffer bytes starting with an IPv6 header
+   * \param size number of valid bytes in buffer
+   * \param info filled with what was found
+   * \returns false if the buffer does not hold an IPv6 header
+   */
+  static bool Parse (const uint8_t *buffer, uint32_t size, Mip6PacketInfo &info);
+
+  /**
+   * \brief Parse the IPv6 packet carried by an IPv4 packet (DSMIP6)
+   *
+   * The IPv6 packet follows the IPv4 header (protocol 41) or a UDP header
+   * from or to \p udpPort (RFC 5555).
+   *
+   * \param buffer bytes starting with an IPv4 header
+   * \param size number of valid bytes in buffer
+   * \param udpPort UDP port of the encapsulation
+   * \param info filled with what was found in the IPv6 packet, with
+   * payloadOffset counted from the start of \p buffer
+   * \returns false if the buffer does not hold an encapsulated IPv6
+   * packet
+   */
+  static bool ParseIpv4 (const uint8_t *buffer, uint32_t size, uint16_t udpPort,
+                         Mip6PacketInfo &info);
+};
+
+/**
+ * \brief hand the IPv6 packets a node receives and sends to a callback
+ *
+ * Received packets are taken from a node protocol handler, sent ones from
+ * the MacTx trace of each device (of its "Mac" for wifi devices). CSMA,
+ * point-to-point and wifi frames reach MacTx with their link-layer
+ * header (Ethernet, PPP, LLC/SNAP), which is stripped along with any
+ * padding and trailer; other devices are expected to trace the bare IP
+ * packet. Either way the tap is handed the packet starting with its IPv6
+ * header. IPv4 packets, which carry DSMIP6 traffic, can be tapped as
+ * well.
+ */
+class Mip6PacketTap
+{
+public:
+  /// device, packet, and whether the node sent (true) or received it
+  typedef Callback<void, Ptr<NetDevice>, Ptr<const Packet>, bool> TapCallback;
+
+  /**
+   * \param node the node to tap
+   * \param tap called for each IPv6 packet
+   * \param rx whether to tap received packets
+   * \param tx whether to tap sent packets
+   * \param ipv4 whether to tap IPv4 packets too
+   */
+  static void Install (Ptr<Node> node, TapCallback tap, bool rx = true, bool tx = true,
+                       bool ipv4 = false);
+};
+
+} // namespace ns3
+
+#endif /* MIP6_PACKET_PARSER_H */
@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6-pcap-helper.h"
+#include "mip6-packet-parser.h"
+#include "ns3/object.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-helper.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6PcapHelper");
+
+enum
+{
+  // an IPv4 header with options, a UDP header and the headers
+  // Mip6PacketParser reads of the inner IPv6 packet
+  PEEK_BYTES = 320,
+  ICMPV6_REDIRECT = 137,
+  ICMPV6_HA_DISCOVERY_REQUEST = 144,
+  ICMPV6_MOBILE_PREFIX_ADVERTISEMENT = 147,
+  PCAP_LINKTYPE_RAW = 101
+};
+
+// The pcap files of the devices of one node. PcapFileWrapper records
+// each packet with its written length as original length, which would
+// hide the size of truncated tunneled packets: records are written here.
+class Mip6PcapWriter : public Object
+{
+public:
+  Mip6PcapWriter (std::string prefix, uint32_t snapLen, uint16_t dsmip6Port)
+    : m_prefix (prefix),
+      m_snapLen (snapLen),
+      m_dsmip6Port (dsmip6Port)
+  {
+  }
+
+  void
+  Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+  {
+    uint8_t buffer[PEEK_BYTES];
+    uint32_t size = packet->CopyData (buffer, sizeof (buffer));
+    Mip6PacketInfo info;
+    bool encapsulated;
+    if (size > 0 && (buffer[0] >> 4) == 4)
+      {
+        if (!Mip6PacketParser::ParseIpv4 (buffer, size, m_dsmip6Port, info))
+          {
+            return;
+          }
+        encapsulated = true;
+      }
+    else
+      {
+        if (!Mip6PacketParser::Parse (buffer, size, info))
+          {
+            return;
+          }
+        encapsulated = info.tunneled;
+      }
+
+    uint32_t length = packet->GetSize ();
+    bool icmp = info.protocol == 58
+      && ((info.icmpType >= Mip6PacketInfo::ND_ROUTER_SOLICITATION
+           && info.icmpType <= ICMPV6_REDIRECT)
+          || (info.icmpType >= ICMPV6_HA_DISCOVERY_REQUEST
+              && info.icmpType <= ICMPV6_MOBILE_PREFIX_ADVERTISEMENT));
+    if (!info.hasMobilityHeader && !icmp)
+      {
+        if (!encapsulated)
+          {
+            return;
+          }
+        // headers only
+        length = std::min (length, info.payloadOffset);
+      }
+    Write (device, packet, std::min (length, m_snapLen));
+  }
+
+  void
+  Close (void)
+  {
+    for (std::map<uint32_t, std::ofstream *>::iterator i = m_files.begin ();
+         i != m_files.end (); ++i)
+      {
+        delete i->second;
+      }
+    m_files.clear ();
+  }
+
+private:
+  virtual void
+  DoDispose (void)
+  {
+    Close ();
+    Object::DoDispose ();
+  }
+
+  template <typename T>
+  static void
+  Put (std::ostream &os, T value)
+  {
+    os.write (reinterpret_cast<const char *> (&value), sizeof (value));
+  }
+
+  std::ofstream *
+  GetFile (Ptr<NetDevice> device)
+  {
+    std::map<uint32_t, std::ofstream *>::iterator i = m_files.find (device->GetIfIndex ());
+    if (i != m_files.end ())
+      {
+        return i->second;
+      }
+    PcapHelper pcap;
+    std::string name = pcap.GetFilenameFromDevice (m_prefix, device);
+    std::ofstream *file = new std::ofstream (name.c_str (), std::ios::out | std::ios::binary);
+    NS_ABORT_MSG_IF (!*file, "cannot write " << name);
+    // host byte order, as the magic number tells readers
+    Put<uint32_t> (*file, 0xa1b2c3d4);
+    Put<uint16_t> (*file, 2);
+    Put<uint16_t> (*file, 4);
+    Put<int32_t> (*file, 0);
+    Put<uint32_t> (*file, 0);
+    Put<uint32_t> (*file, m_snapLen);
+    Put<uint32_t> (*file, PCAP_LINKTYPE_RAW);
+    m_files[device->GetIfIndex ()] = file;
+    return file;
+  }
+
+  void
+  Write (Ptr<NetDevice> device, Ptr<const Packet> packet, uint32_t length)
+  {
+    std::ofstream *file = GetFile (device);
+    uint64_t us = Simulator::Now ().GetMicroSeconds ();
+    Put<uint32_t> (*file, us / 1000000);
+    Put<uint32_t> (*file, us % 1000000);
+    Put<uint32_t> (*file, length);
+    Put<uint32_t> (*file, packet->GetSize ());
+    if (length > m_scratch.size ())
+      {
+        m_scratch.resize (length);
+      }
+    if (length > 0)
+      {
+        packet->CopyData (&m_scratch[0], length);
+        file->write (reinterpret_cast<const char *> (&m_scratch[0]), length);
+      }
+  }
+
+  std::string m_prefix;
+  uint32_t m_snapLen;
+  uint16_t m_dsmip6Port;
+  // interface index to its file
+  std::map<uint32_t, std::ofstream *> m_files;
+  std::vector<uint8_t> m_scratch;
+};
+
+Mip6PcapHelper::Mip6PcapHelper ()
+  : m_snapLen (128),
+    m_dsmip6Port (4191)
+{
+}
+
+void
+Mip6PcapHelper::SetSnapLength (uint32_t snapLen)
+{
+  m_snapLen = snapLen;
+}
+
+void
+Mip6PcapHelper::SetDsmip6Port (uint16_t port)
+{
+  m_dsmip6Port = port;
+}
+
+void
+Mip6PcapHelper::EnablePcap (std::string prefix, NodeContainer nodes)
+{
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<Mip6PcapWriter> writer = CreateObject<Mip6PcapWriter> (prefix, m_snapLen, m_dsmip6Port);
+      Mip6PacketTap::Install (*i, MakeCallback (&Mip6PcapWriter::Tap, writer), true, true, true);
+      // the taps keep the writer alive until the nodes are disposed
+      Simulator::ScheduleDestroy (&Mip6PcapWriter::Close, writer);
+    }
+}
+
+void
+Mip6PcapHelper::EnablePcapAll (std::string prefix)
+{
+  EnablePcap (prefix, NodeContainer::GetGlobal ());
+}
+
+} // namespace ns3
@@ -0,0 +1,74 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6_PCAP_HELPER_H
+#define MIP6_PCAP_HELPER_H
+
+#include "ns3/node-container.h"
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief capture only the mobility related part of the traffic
+ *
+ * Unlike the EnablePcapAll () of device helpers, which writes every
+ * packet in full, the capture keeps:
+ *  - packets carrying a Mobility Header
+ *  - ICMPv6 Neighbor Discovery (RS, RA, NS, NA, Redirect) and the
+ *    Mobile IPv6 ICMPv6 messages (HA address discovery, mobile prefix)
+ *  - the headers of tunneled packets, IPv6-in-IPv6 and DSMIP6, up to the
+ *    inner upper-layer header
+ *
+ * and nothing of the native data traffic. Each kept packet is truncated
+ * to the snap length. Files are named like those of EnablePcap ()
+ * (\<prefix\>-\<node\>-\<device\>.pcap) and hold raw IP packets
+ * (DLT_RAW), with the original length of each packet recorded.
+ */
+class Mip6PcapHelper
+{
+public:
+  Mip6PcapHelper ();
+
+  /**
+   * \param snapLen bytes kept per packet, 128 by default
+   */
+  void SetSnapLength (uint32_t snapLen);
+  /**
+   * \param port UDP port of DSMIP6 encapsulation, 4191 by default
+   */
+  void SetDsmip6Port (uint16_t port);
+
+  /**
+   * \brief Capture on every device of some nodes
+   * \param prefix file name prefix
+   * \param nodes the nodes
+   */
+  void EnablePcap (std::string prefix, NodeContainer nodes);
+  /**
+   * \brief Capture on every device of every node
+   * \param prefix file name prefix
+   */
+  void EnablePcapAll (std::string prefix);
+
+private:
+  uint32_t m_snapLen;
+  uint16_t m_dsmip6Port;
+};
+
+} // namespace ns3
+
+#endif /* MIP6_PCAP_HELPER_H */
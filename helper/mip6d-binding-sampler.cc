@@ -0,0 +1,244 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6d-binding-sampler.h"
+#include "mip6-packet-parser.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6dBindingSampler");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6dBindingSampler);
+
+TypeId
+Mip6dBindingSampler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dBindingSampler")
+    .SetParent<Object> ()
+    .AddConstructor<Mip6dBindingSampler> ()
+    .AddAttribute ("Interval", "Time between two samples.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&Mip6dBindingSampler::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("KeepSamples", "Store the samples for GetSamples () and Print ().",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&Mip6dBindingSampler::m_keepSamples),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("Sample", "The binding activity of a watched node over the last "
+                     "interval.",
+                     MakeTraceSourceAccessor (&Mip6dBindingSampler::m_sampleTrace),
+                     "ns3::Mip6dBindingSampler::SampleCallback")
+  ;
+  return tid;
+}
+
+Mip6dBindingSampler::Mip6dBindingSampler ()
+{
+}
+
+void
+Mip6dBindingSampler::DoDispose (void)
+{
+  m_sampleEvent.Cancel ();
+  m_homeAgents.clear ();
+  m_samples.clear ();
+  Object::DoDispose ();
+}
+
+void
+Mip6dBindingSampler::Watch (Ptr<Node> node)
+{
+  if (m_homeAgents.find (node->GetId ()) != m_homeAgents.end ())
+    {
+      return;
+    }
+  HomeAgent &ha = m_homeAgents[node->GetId ()];
+  ha.peak = 0;
+  ha.buReceived = 0;
+  ha.baSent = 0;
+  ha.serviced = 0;
+  Mip6PacketTap::Install (node, MakeCallback (&Mip6dBindingSampler::Tap,
+                                              Ptr<Mip6dBindingSampler> (this)));
+  if (!m_sampleEvent.IsRunning ())
+    {
+      m_sampleEvent = Simulator::Schedule (m_interval, &Mip6dBindingSampler::Sample, this);
+    }
+}
+
+void
+Mip6dBindingSampler::Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  Mip6PacketInfo info;
+  if (!Mip6PacketParser::Parse (packet, info) || !info.hasMobilityHeader)
+    {
+      return;
+    }
+  HomeAgent &ha = m_homeAgents[device->GetNode ()->GetId ()];
+  Time now = Simulator::Now ();
+
+  if (!sent && info.mhType == Mip6PacketInfo::MH_BU)
+    {
+      ha.buReceived++;
+      // a retransmission keeps the time of the first copy
+      std::map<Ipv6Address, Pending>::iterator i = ha.pending.find (info.source);
+      if (i == ha.pending.end () || i->second.sequence != info.sequence)
+        {
+          Pending &pending = ha.pending[info.source];
+          pending.sequence = info.sequence;
+          pending.received = now;
+        }
+    }
+  else if (sent && info.mhType == Mip6PacketInfo::MH_BA)
+    {
+      ha.baSent++;
+      std::map<Ipv6Address, Pending>::iterator i = ha.pending.find (info.destination);
+      if (i != ha.pending.end () && i->second.sequence == info.sequence)
+        {
+          Time service = now - i->second.received;
+          ha.serviced++;
+          ha.serviceSum += service;
+          ha.serviceMax = std::max (ha.serviceMax, service);
+          ha.pending.erase (i);
+        }
+
+      // 128 and above are rejections
+      if (info.status >= 128)
+        {
+          return;
+        }
+      Ipv6Address key = info.destination;
+      if (info.hasRoutingHeader2)
+        {
+          key = info.routingHomeAddress;
+        }
+      else if (info.hasHomeNetworkPrefix)
+        {
+          key = info.homeNetworkPrefix;
+        }
+      if (info.lifetime == 0)
+        {
+          ha.bindings.erase (key);
+          return;
+        }
+      Time expiry = now + Seconds (info.lifetime * 4);
+      ha.bindings[key] = expiry;
+      ha.expiries.insert (std::make_pair (expiry, key));
+    }
+}
+
+void
+Mip6dBindingSampler::Expire (HomeAgent &ha)
+{
+  Time now = Simulator::Now ();
+  while (!ha.expiries.empty () && ha.expiries.begin ()->first <= now)
+    {
+      std::multimap<Time, Ipv6Address>::iterator e = ha.expiries.begin ();
+      std::map<Ipv6Address, Time>::iterator b = ha.bindings.find (e->second);
+      // refreshed bindings left a stale entry behind
+      if (b != ha.bindings.end () && b->second == e->first)
+        {
+          ha.bindings.erase (b);
+        }
+      ha.expiries.erase (e);
+    }
+}
+
+void
+Mip6dBindingSampler::Sample (void)
+{
+  for (std::map<uint32_t, HomeAgent>::iterator i = m_homeAgents.begin ();
+       i != m_homeAgents.end (); ++i)
+    {
+      HomeAgent &ha = i->second;
+      Expire (ha);
+
+      Mip6dBindingSample sample;
+      sample.time = Simulator::Now ();
+      sample.node = i->first;
+      sample.cacheSize = ha.bindings.size ();
+      sample.buReceived = ha.buReceived;
+      sample.buRate = ha.buReceived / m_interval.GetSeconds ();
+      sample.baSent = ha.baSent;
+      sample.serviceMean = ha.serviced ? NanoSeconds (ha.serviceSum.GetNanoSeconds () / ha.serviced)
+        : Seconds (0);
+      sample.serviceMax = ha.serviceMax;
+      ha.peak = std::max (ha.peak, sample.cacheSize);
+      ha.buReceived = 0;
+      ha.baSent = 0;
+      ha.serviced = 0;
+      ha.serviceSum = Seconds (0);
+      ha.serviceMax = Seconds (0);
+
+      NS_LOG_INFO ("node " << sample.node << " bindings " << sample.cacheSize
+                   << " BU/s " << sample.buRate);
+      m_sampleTrace (sample);
+      if (m_keepSamples)
+        {
+          m_samples.push_back (sample);
+        }
+    }
+  m_sampleEvent = Simulator::Schedule (m_interval, &Mip6dBindingSampler::Sample, this);
+}
+
+const std::vector<Mip6dBindingSample> &
+Mip6dBindingSampler::GetSamples (void) const
+{
+  return m_samples;
+}
+
+uint32_t
+Mip6dBindingSampler::GetCacheSize (Ptr<Node> node)
+{
+  std::map<uint32_t, HomeAgent>::iterator i = m_homeAgents.find (node->GetId ());
+  if (i == m_homeAgents.end ())
+    {
+      return 0;
+    }
+  Expire (i->second);
+  return i->second.bindings.size ();
+}
+
+uint32_t
+Mip6dBindingSampler::GetPeakCacheSize (Ptr<Node> node) const
+{
+  std::map<uint32_t, HomeAgent>::const_iterator i = m_homeAgents.find (node->GetId ());
+  if (i == m_homeAgents.end ())
+    {
+      return 0;
+    }
+  return i->second.peak;
+}
+
+void
+Mip6dBindingSampler::Print (std::ostream &os) const
+{
+  os << "time,node,bindings,bu,bu_per_s,ba,service_mean_ms,service_max_ms" << std::endl;
+  for (std::vector<Mip6dBindingSample>::const_iterator i = m_samples.begin ();
+       i != m_samples.end (); ++i)
+    {
+      os << i->time.GetSeconds () << "," << i->node << "," << i->cacheSize << ","
+         << i->buReceived << "," << i->buRate << "," << i->baSent << ","
+         << i->serviceMean.GetSeconds () * 1000 << ","
+         << i->serviceMax.GetSeconds () * 1000 << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6D_BINDING_SAMPLER_H
+#define MIP6D_BINDING_SAMPLER_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
+#include <ostream>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief binding activity of one home agent (or LMA) over one interval
+ */
+struct Mip6dBindingSample
+{
+  /// end of the interval
+  Time time;
+  uint32_t node;
+  /// bindings accepted and not expired nor deregistered at the end
+  uint32_t cacheSize;
+  /// BUs received during the interval
+  uint32_t buReceived;
+  /// BUs received per second
+  double buRate;
+  /// BAs sent during the interval
+  uint32_t baSent;
+  /// mean and max time from a BU to its BA, zero if no BA matched a BU
+  Time serviceMean;
+  Time serviceMax;
+};
+
+/**
+ * \brief periodic binding cache, BU rate and BU to BA service time of
+ * home agents
+ *
+ * The sampler sniffs the Mobility Header signaling of each watched node
+ * instead of querying the daemon: it counts the (Proxy) Binding Updates
+ * the node receives, matches the Binding Acknowledgements it sends to
+ * them by peer address and sequence number, and mirrors its binding
+ * cache from the accepted BAs and their lifetimes. Bindings are keyed by
+ * home address, or by home network prefix for Proxy Mobile IPv6.
+ *
+ * Each interval costs one event for all watched nodes; each packet costs
+ * the parse of its first bytes, so the sampler can stay on in large runs.
+ * Set KeepSamples to false to only hook the Sample trace. Sampling goes
+ * on until the simulation is stopped.
+ *
+ * Mip6dHelper::EnableBindingSampler () watches every node the helper
+ * installs with EnableHA () or EnableLMA ().
+ */
+class Mip6dBindingSampler : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6dBindingSampler ();
+
+  /**
+   * \brief Sample the binding activity of a node
+   * \param node a home agent or LMA
+   */
+  void Watch (Ptr<Node> node);
+
+  /**
+   * \returns the samples taken so far, in time order
+   */
+  const std::vector<Mip6dBindingSample> & GetSamples (void) const;
+  /**
+   * \param node a watched node
+   * \returns the current size of its binding cache
+   */
+  uint32_t GetCacheSize (Ptr<Node> node);
+  /**
+   * \param node a watched node
+   * \returns the largest binding cache size sampled so far
+   */
+  uint32_t GetPeakCacheSize (Ptr<Node> node) const;
+
+  /**
+   * \brief Print the samples as CSV, one line per node and interval
+   * \param os output stream
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  struct Pending
+  {
+    uint16_t sequence;
+    Time received;
+  };
+  struct HomeAgent
+  {
+    // binding key (HoA or HNP) to expiry
+    std::map<Ipv6Address, Time> bindings;
+    // expiries in time order, possibly stale, for purging
+    std::multimap<Time, Ipv6Address> expiries;
+    // BU source to the last BU not acknowledged yet
+    std::map<Ipv6Address, Pending> pending;
+    uint32_t peak;
+    uint32_t buReceived;
+    uint32_t baSent;
+    // BAs matched to a pending BU
+    uint32_t serviced;
+    Time serviceSum;
+    Time serviceMax;
+  };
+
+  virtual void DoDispose (void);
+  void Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+  void Sample (void);
+  static void Expire (HomeAgent &ha);
+
+  std::map<uint32_t, HomeAgent> m_homeAgents;
+  std::vector<Mip6dBindingSample> m_samples;
+  Time m_interval;
+  bool m_keepSamples;
+  EventId m_sampleEvent;
+  TracedCallback<const Mip6dBindingSample &> m_sampleTrace;
+};
+
+} // namespace ns3
+
+#endif /* MIP6D_BINDING_SAMPLER_H */
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6d-convergence-monitor.h"
+#include "mip6-packet-parser.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6dConvergenceMonitor");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6dConvergenceMonitor);
+
+TypeId
+Mip6dConvergenceMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dConvergenceMonitor")
+    .SetParent<Object> ()
+    .AddConstructor<Mip6dConvergenceMonitor> ()
+    .AddAttribute ("StopDelay", "Stop the simulation this long after convergence; "
+                   "negative to keep running.",
+                   TimeValue (Seconds (-1)),
+                   MakeTimeAccessor (&Mip6dConvergenceMonitor::m_stopDelay),
+                   MakeTimeChecker ())
+    .AddTraceSource ("BindingAck", "A watched node received a Binding Acknowledgement: "
+                     "the node, its status and its sequence number.",
+                     MakeTraceSourceAccessor (&Mip6dConvergenceMonitor::m_bindingAckTrace),
+                     "ns3::Mip6dConvergenceMonitor::BindingAckCallback")
+    .AddTraceSource ("Converged", "Every watched node has registered with its home agent.",
+                     MakeTraceSourceAccessor (&Mip6dConvergenceMonitor::m_convergedTrace),
+                     "ns3::Time::TracedCallback")
+  ;
+  return tid;
+}
+
+Mip6dConvergenceMonitor::Mip6dConvergenceMonitor ()
+  : m_nRegistered (0),
+    m_convergenceTime (Seconds (-1))
+{
+}
+
+void
+Mip6dConvergenceMonitor::DoDispose (void)
+{
+  m_registered.clear ();
+  Object::DoDispose ();
+}
+
+void
+Mip6dConvergenceMonitor::Watch (Ptr<Node> node)
+{
+  if (m_registered.find (node->GetId ()) != m_registered.end ())
+    {
+      return;
+    }
+  m_registered[node->GetId ()] = Seconds (-1);
+  // all devices: the BA may come in through any of the egress interfaces.
+  // The node keeps the monitor alive for as long as the simulation.
+  Mip6PacketTap::Install (node, MakeCallback (&Mip6dConvergenceMonitor::Receive,
+                                              Ptr<Mip6dConvergenceMonitor> (this)),
+                          true, false);
+}
+
+void
+Mip6dConvergenceMonitor::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                                  bool sent)
+{
+  Mip6PacketInfo info;
+  if (!Mip6PacketParser::Parse (packet, info) || !info.hasMobilityHeader
+      || info.mhType != Mip6PacketInfo::MH_BA)
+    {
+      return;
+    }
+
+  Ptr<Node> node = device->GetNode ();
+  NS_LOG_INFO ("node " << node->GetId () << " got BA status " << (uint32_t)info.status
+               << " seq " << info.sequence);
+  m_bindingAckTrace (node, info.status, info.sequence);
+
+  // 128 and above are rejections
+  Time &registered = m_registered[node->GetId ()];
+  if (info.status >= 128 || registered >= Seconds (0))
+    {
+      return;
+    }
+  registered = Simulator::Now ();
+  m_nRegistered++;
+  if (m_nRegistered < m_registered.size ())
+    {
+      return;
+    }
+
+  m_convergenceTime = Simulator::Now ();
+  NS_LOG_INFO ("all " << m_nRegistered << " mobile nodes registered at "
+               << m_convergenceTime.GetSeconds () << "s");
+  m_convergedTrace (m_convergenceTime);
+  if (m_stopDelay >= Seconds (0))
+    {
+      Simulator::Stop (m_stopDelay);
+    }
+}
+
+bool
+Mip6dConvergenceMonitor::IsConverged (void) const
+{
+  return m_convergenceTime >= Seconds (0);
+}
+
+Time
+Mip6dConvergenceMonitor::GetConvergenceTime (void) const
+{
+  return m_convergenceTime;
+}
+
+uint32_t
+Mip6dConvergenceMonitor::GetNWatched (void) const
+{
+  return m_registered.size ();
+}
+
+uint32_t
+Mip6dConvergenceMonitor::GetNRegistered (void) const
+{
+  return m_nRegistered;
+}
+
+} // namespace ns3
@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6D_CONVERGENCE_MONITOR_H
+#define MIP6D_CONVERGENCE_MONITOR_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief tell when every watched MN/MR has registered with its home agent
+ *
+ * The monitor listens to the IPv6 packets received by the watched nodes
+ * and looks for Binding Acknowledgements. Once each of them has received
+ * an accepting one (status below 128), the Converged trace fires. Typical
+ * users start measuring from there instead of at a fixed time, and can
+ * stop the simulation StopDelay later.
+ *
+ * Mip6dHelper::EnableConvergenceMonitor () watches every MN and MR the
+ * helper installs.
+ */
+class Mip6dConvergenceMonitor : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6dConvergenceMonitor ();
+
+  /**
+   * \brief Expect a Binding Acknowledgement on a node
+   * \param node a mobile node or mobile router
+   */
+  void Watch (Ptr<Node> node);
+
+  /**
+   * \returns whether every watched node has registered
+   */
+  bool IsConverged (void) const;
+  /**
+   * \returns when the last watched node registered, or a negative time
+   * if not converged yet
+   */
+  Time GetConvergenceTime (void) const;
+  /**
+   * \returns the number of watched nodes
+   */
+  uint32_t GetNWatched (void) const;
+  /**
+   * \returns the number of watched nodes which have registered
+   */
+  uint32_t GetNRegistered (void) const;
+
+private:
+  virtual void DoDispose (void);
+  void Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+
+  // node id to time of its first accepting BA, negative until then
+  std::map<uint32_t, Time> m_registered;
+  uint32_t m_nRegistered;
+  Time m_convergenceTime;
+  Time m_stopDelay;
+  TracedCallback<Ptr<Node>, uint8_t, uint16_t> m_bindingAckTrace;
+  TracedCallback<Time> m_convergedTrace;
+};
+
+} // namespace ns3
+
+#endif /* MIP6D_CONVERGENCE_MONITOR_H */
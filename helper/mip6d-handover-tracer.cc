@@ -0,0 +1,374 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6d-handover-tracer.h"
+#include "mip6-packet-parser.h"
+#include "ns3/simulator.h"
+#include "ns3/node-list.h"
+#include "ns3/pointer.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/trace-source-accessor.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6dHandoverTracer");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6dHandoverTracer);
+
+TypeId
+Mip6dHandoverTracer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dHandoverTracer")
+    .SetParent<Object> ()
+    .AddConstructor<Mip6dHandoverTracer> ()
+    .AddAttribute ("RouterTimeout",
+                   "How long the default router may stay silent before a Router "
+                   "Advertisement from another router is taken as a move to it. "
+                   "Longer than the advertisement interval of the routers.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&Mip6dHandoverTracer::m_routerTimeout),
+                   MakeTimeChecker ())
+    .AddTraceSource ("L2Attach", "A device of the node came up or associated.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_l2AttachTrace),
+                     "ns3::Mip6dHandoverTracer::L2AttachCallback")
+    .AddTraceSource ("RaReceived", "A Router Advertisement was received from this router.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_raReceivedTrace),
+                     "ns3::Mip6dHandoverTracer::AddressCallback")
+    .AddTraceSource ("CoaConfigured", "Duplicate Address Detection started for this "
+                     "global address.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_coaConfiguredTrace),
+                     "ns3::Mip6dHandoverTracer::AddressCallback")
+    .AddTraceSource ("BuSent", "A Binding Update was sent, with this sequence number.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_buSentTrace),
+                     "ns3::Mip6dHandoverTracer::BuSentCallback")
+    .AddTraceSource ("BaReceived", "A Binding Acknowledgement was received: its status "
+                     "and sequence number.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_baReceivedTrace),
+                     "ns3::Mip6dHandoverTracer::BaReceivedCallback")
+    .AddTraceSource ("FirstTunneledData", "The first tunneled data packet of a handover "
+                     "was received.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_firstTunneledDataTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Handover", "A handover ended, either completed by tunneled data "
+                     "or cut short by the next one.",
+                     MakeTraceSourceAccessor (&Mip6dHandoverTracer::m_handoverTrace),
+                     "ns3::Mip6dHandoverTracer::HandoverCallback")
+  ;
+  return tid;
+}
+
+Mip6dHandoverTracer::Mip6dHandoverTracer ()
+  : m_node (0),
+    m_routerLastRa (Seconds (-1)),
+    m_candidateRa (Seconds (-1)),
+    m_dadStarted (Seconds (-1)),
+    m_firstBuSent (Seconds (-1)),
+    m_firstRegistration (Seconds (-1)),
+    m_open (false)
+{
+}
+
+void
+Mip6dHandoverTracer::DoDispose (void)
+{
+  m_handovers.clear ();
+  Object::DoDispose ();
+}
+
+Ptr<Mip6dHandoverTracer>
+Mip6dHandoverTracer::Install (Ptr<Node> node)
+{
+  Ptr<Mip6dHandoverTracer> tracer = node->GetObject<Mip6dHandoverTracer> ();
+  if (!tracer)
+    {
+      tracer = CreateObject<Mip6dHandoverTracer> ();
+      node->AggregateObject (tracer);
+      tracer->Attach (node);
+    }
+  return tracer;
+}
+
+void
+Mip6dHandoverTracer::Attach (Ptr<Node> node)
+{
+  m_node = node->GetId ();
+  Ptr<Mip6dHandoverTracer> self = this;
+  for (uint32_t i = 0; i < node->GetNDevices (); i++)
+    {
+      Ptr<NetDevice> device = node->GetDevice (i);
+      device->AddLinkChangeCallback (MakeBoundCallback (&Mip6dHandoverTracer::LinkChange,
+                                                        self, device));
+      // a wifi station reports each (re)association with an AP
+      PointerValue mac;
+      if (device->GetAttributeFailSafe ("Mac", mac) && mac.Get<Object> ())
+        {
+          mac.Get<Object> ()->TraceConnectWithoutContext ("Assoc",
+                                                         MakeBoundCallback (&Mip6dHandoverTracer::Associated,
+                                                                            self, device));
+        }
+    }
+  Mip6PacketTap::Install (node, MakeCallback (&Mip6dHandoverTracer::Tap, self));
+}
+
+void
+Mip6dHandoverTracer::LinkChange (Ptr<Mip6dHandoverTracer> tracer, Ptr<NetDevice> device)
+{
+  if (device->IsLinkUp ())
+    {
+      tracer->L2Attach (device);
+    }
+}
+
+void
+Mip6dHandoverTracer::Associated (Ptr<Mip6dHandoverTracer> tracer, Ptr<NetDevice> device,
+                                 Mac48Address bssid)
+{
+  tracer->L2Attach (device);
+}
+
+void
+Mip6dHandoverTracer::L2Attach (Ptr<NetDevice> device)
+{
+  NS_LOG_INFO ("node " << m_node << " attached on device " << device->GetIfIndex ());
+  m_l2AttachTrace (device);
+  StartHandover (Simulator::Now ());
+}
+
+void
+Mip6dHandoverTracer::Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  Mip6PacketInfo info;
+  if (!Mip6PacketParser::Parse (packet, info))
+    {
+      return;
+    }
+  Time now = Simulator::Now ();
+
+  if (sent)
+    {
+      // DAD of a global address: the node is configuring a care-of address
+      if (!info.tunneled && info.icmpType == Mip6PacketInfo::ND_NEIGHBOR_SOLICITATION
+          && info.source.IsAny () && !info.ndTarget.IsLinkLocal ())
+        {
+          m_coaConfiguredTrace (info.ndTarget);
+          m_dadStarted = now;
+          if (m_open && m_current.coaConfigured < Seconds (0))
+            {
+              m_current.coaConfigured = now;
+            }
+        }
+      else if (info.hasMobilityHeader && info.mhType == Mip6PacketInfo::MH_BU)
+        {
+          m_buSentTrace (info.sequence);
+          if (m_firstBuSent < Seconds (0))
+            {
+              m_firstBuSent = now;
+            }
+          // a care-of address of its own: mip6d has moved to the new router
+          bool newCoa = !(info.source == m_coa);
+          m_coa = info.source;
+          if (newCoa && m_candidateRa >= Seconds (0))
+            {
+              ChangeRouter ();
+            }
+          if (m_open && m_current.buSent < Seconds (0))
+            {
+              m_current.buSent = now;
+            }
+        }
+      return;
+    }
+
+  if (!info.tunneled && info.icmpType == Mip6PacketInfo::ND_ROUTER_ADVERTISEMENT)
+    {
+      m_raReceivedTrace (info.source);
+      RouterAdvertisement (info.source);
+    }
+  else if (info.hasMobilityHeader && info.mhType == Mip6PacketInfo::MH_BA)
+    {
+      m_baReceivedTrace (info.status, info.sequence);
+      // 128 and above are rejections
+      if (info.status < 128 && m_firstRegistration < Seconds (0))
+        {
+          m_firstRegistration = now;
+        }
+      if (m_open && info.status < 128 && m_current.baReceived < Seconds (0))
+        {
+          m_current.baReceived = now;
+        }
+    }
+  else if (info.tunneled && !info.hasMobilityHeader && m_open
+           && m_current.baReceived >= Seconds (0))
+    {
+      m_current.firstTunneledData = now;
+      m_firstTunneledDataTrace (packet);
+      CloseHandover ();
+    }
+}
+
+void
+Mip6dHandoverTracer::RouterAdvertisement (Ipv6Address router)
+{
+  Time now = Simulator::Now ();
+  if ((m_open && m_current.raReceived < Seconds (0)) || m_routerLastRa < Seconds (0))
+    {
+      // first router after an attach event, or ever
+      if (!m_open)
+        {
+          StartHandover (now);
+        }
+      m_current.raReceived = now;
+      m_router = router;
+      m_routerLastRa = now;
+      return;
+    }
+  if (router == m_router)
+    {
+      m_routerLastRa = now;
+      m_candidateRa = Seconds (-1);
+      return;
+    }
+  // On links without attach events, e.g. ad hoc wifi, a mobile node in
+  // range of two routers hears both: another router only becomes the
+  // default one once mip6d sends a Binding Update from a new care-of
+  // address, or once the current router is silent for too long.
+  if (m_candidateRa < Seconds (0) || !(router == m_candidate))
+    {
+      m_candidate = router;
+      m_candidateRa = now;
+    }
+  if (now - m_routerLastRa > m_routerTimeout)
+    {
+      ChangeRouter ();
+    }
+}
+
+void
+Mip6dHandoverTracer::ChangeRouter (void)
+{
+  // the handover started with the first advertisement of the new router
+  // since the old one was last heard
+  Time start = m_candidateRa;
+  StartHandover (start);
+  m_current.raReceived = start;
+  if (m_dadStarted >= start)
+    {
+      m_current.coaConfigured = m_dadStarted;
+    }
+  m_router = m_candidate;
+  m_routerLastRa = Simulator::Now ();
+}
+
+void
+Mip6dHandoverTracer::StartHandover (Time start)
+{
+  if (m_open)
+    {
+      CloseHandover ();
+    }
+  Time none = Seconds (-1);
+  m_candidateRa = none;
+  m_current.node = m_node;
+  m_current.start = start;
+  m_current.raReceived = none;
+  m_current.coaConfigured = none;
+  m_current.buSent = none;
+  m_current.baReceived = none;
+  m_current.firstTunneledData = none;
+  m_open = true;
+}
+
+void
+Mip6dHandoverTracer::CloseHandover (void)
+{
+  NS_LOG_INFO (m_current);
+  m_handovers.push_back (m_current);
+  m_open = false;
+  m_handoverTrace (m_current);
+}
+
+std::vector<Mip6dHandover>
+Mip6dHandoverTracer::GetHandovers (void) const
+{
+  std::vector<Mip6dHandover> handovers = m_handovers;
+  if (m_open)
+    {
+      handovers.push_back (m_current);
+    }
+  return handovers;
+}
+
+Time
+Mip6dHandoverTracer::GetFirstBuSent (void) const
+{
+  return m_firstBuSent;
+}
+
+Time
+Mip6dHandoverTracer::GetFirstRegistration (void) const
+{
+  return m_firstRegistration;
+}
+
+void
+Mip6dHandoverTracer::PrintHandovers (std::ostream &os)
+{
+  os << "node start(s) l2-ra ra-coa coa-bu bu-ba ba-data total(ms)" << std::endl;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Mip6dHandoverTracer> tracer = (*i)->GetObject<Mip6dHandoverTracer> ();
+      if (!tracer)
+        {
+          continue;
+        }
+      std::vector<Mip6dHandover> handovers = tracer->GetHandovers ();
+      for (std::vector<Mip6dHandover>::const_iterator h = handovers.begin ();
+           h != handovers.end (); ++h)
+        {
+          os << *h << std::endl;
+        }
+    }
+}
+
+static void
+PrintStage (std::ostream &os, Time from, Time to)
+{
+  if (from < Seconds (0) || to < Seconds (0))
+    {
+      os << " -";
+    }
+  else
+    {
+      os << " " << (to - from).GetMilliSeconds ();
+    }
+}
+
+std::ostream &
+operator << (std::ostream &os, const Mip6dHandover &handover)
+{
+  os << handover.node << " " << handover.start.GetSeconds ();
+  PrintStage (os, handover.start, handover.raReceived);
+  PrintStage (os, handover.raReceived, handover.coaConfigured);
+  PrintStage (os, handover.coaConfigured, handover.buSent);
+  PrintStage (os, handover.buSent, handover.baReceived);
+  PrintStage (os, handover.baReceived, handover.firstTunneledData);
+  PrintStage (os, handover.start, handover.firstTunneledData);
+  return os;
+}
+
+} // namespace ns3
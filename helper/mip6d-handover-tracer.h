@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6D_HANDOVER_TRACER_H
+#define MIP6D_HANDOVER_TRACER_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/traced-callback.h"
+#include "ns3/mac48-address.h"
+#include "ns3/packet.h"
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief timestamps of the stages of one handover of a mobile node
+ *
+ * A stage not seen (yet) has a negative time.
+ */
+struct Mip6dHandover
+{
+  uint32_t node;
+  /// L2 attach, or the first RA from the new default router if the link
+  /// has no attach event (e.g. ad hoc wifi)
+  Time start;
+  Time raReceived;
+  Time coaConfigured;
+  Time buSent;
+  Time baReceived;
+  Time firstTunneledData;
+};
+
+/**
+ * \brief handover trace sources of a node running mip6d
+ *
+ * Mip6dHelper::EnableHandoverTracing () aggregates one to every node it
+ * installs mip6d on, so the traces are reachable as e.g.
+ * "/NodeList/[i]/$ns3::Mip6dHandoverTracer/BuSent". The stages are read
+ * from the packets the node sends and receives:
+ *  - L2Attach: device link up, or association of a wifi station
+ *  - RaReceived: Router Advertisement received
+ *  - CoaConfigured: Duplicate Address Detection started for a global
+ *    address, i.e. the address is being configured
+ *  - BuSent / BaReceived: Binding Update and Acknowledgement
+ *  - FirstTunneledData: first IPv6-in-IPv6 data packet received after
+ *    the Binding Acknowledgement, which completes the handover
+ *
+ * On links without attach events, a handover starts when the default
+ * router changes: Router Advertisements from another router only count
+ * once a Binding Update is sent from a new care-of address, or once the
+ * current router has been silent for RouterTimeout, so that a node in
+ * range of two routers does not see a handover at each advertisement.
+ */
+class Mip6dHandoverTracer : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6dHandoverTracer ();
+
+  /**
+   * \brief Aggregate a tracer to a node and tap its devices, unless the
+   * node already has one
+   * \param node the node
+   * \returns the tracer of the node
+   */
+  static Ptr<Mip6dHandoverTracer> Install (Ptr<Node> node);
+
+  /**
+   * \returns the handovers of this node, completed or not
+   */
+  std::vector<Mip6dHandover> GetHandovers (void) const;
+
+  /**
+   * \returns when the node sent its first Binding Update, or a negative
+   * time if it has not sent any
+   */
+  Time GetFirstBuSent (void) const;
+  /**
+   * \returns when the node first received an accepting Binding
+   * Acknowledgement, or a negative time if it has not registered yet
+   */
+  Time GetFirstRegistration (void) const;
+
+  /**
+   * \brief Print the stage latencies of every handover of every traced node
+   * \param os output stream
+   */
+  static void PrintHandovers (std::ostream &os);
+
+private:
+  virtual void DoDispose (void);
+  void Attach (Ptr<Node> node);
+  static void LinkChange (Ptr<Mip6dHandoverTracer> tracer, Ptr<NetDevice> device);
+  static void Associated (Ptr<Mip6dHandoverTracer> tracer, Ptr<NetDevice> device,
+                          Mac48Address bssid);
+  void L2Attach (Ptr<NetDevice> device);
+  void Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+  void RouterAdvertisement (Ipv6Address router);
+  void ChangeRouter (void);
+  void StartHandover (Time start);
+  void CloseHandover (void);
+
+  Time m_routerTimeout;
+  uint32_t m_node;
+  // the default router, and when it was last heard
+  Ipv6Address m_router;
+  Time m_routerLastRa;
+  // another router heard since, and its first advertisement
+  Ipv6Address m_candidate;
+  Time m_candidateRa;
+  Ipv6Address m_coa;
+  Time m_dadStarted;
+  Time m_firstBuSent;
+  Time m_firstRegistration;
+  bool m_open;
+  Mip6dHandover m_current;
+  std::vector<Mip6dHandover> m_handovers;
+
+  TracedCallback<Ptr<NetDevice> > m_l2AttachTrace;
+  TracedCallback<Ipv6Address> m_raReceivedTrace;
+  TracedCallback<Ipv6Address> m_coaConfiguredTrace;
+  TracedCallback<uint16_t> m_buSentTrace;
+  TracedCallback<uint8_t, uint16_t> m_baReceivedTrace;
+  TracedCallback<Ptr<const Packet> > m_firstTunneledDataTrace;
+  TracedCallback<const Mip6dHandover &> m_handoverTrace;
+};
+
+std::ostream & operator << (std::ostream &os, const Mip6dHandover &handover);
+
+} // namespace ns3
+
+#endif /* MIP6D_HANDOVER_TRACER_H */
@@ -20,38 +20,45 @@
 
 #include "ns3/object-factory.h"
 #include "ns3/simulator.h"
+#include "ns3/abort.h"
 #include "mip6d-helper.h"
+#include "kernel-config-helper.h"
+#include "mip6d-log-ring.h"
 #include "ns3/dce-application-helper.h"
 #include "ns3/names.h"
-#include "ns3/linux-socket-fd-factory.h"
 #include <fstream>
 #include <map>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <limits.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 namespace ns3 {
 
 class Mip6dConfig : public Object
 {
-private:
-  static int index;
-  std::string router_id;
 public:
   Mip6dConfig ()
     : m_haenable (false),
       m_mrenable (false),
+      m_cnenable (false),
       m_magenable (false),
       m_debug (false),
-      m_ifinit_delay (2.0),
       m_usemanualconf (false),
-      m_ha_served_pfx (""),
       m_dsmip6enable (false),
-      m_binary ("mip6d")
-  {
-    m_mr_mobile_pfx = new std::vector<std::string> ();
-    m_mr_egress_if = new std::vector<std::string> ();
-    m_mag_mn_profiles = new std::vector<Mip6dConfig::pmipMNprofile_t> ();
-  }
-  ~Mip6dConfig ()
+      m_ro_mn (false),
+      m_has_ha_served_pfx (false),
+      m_has_mn_ha_addr (false),
+      m_has_mr_home_addr (false),
+      m_has_mag_egress_gaddr (false),
+      m_debug_level (10),
+      m_log_ring (0),
+      m_ifinit_delay (2.0),
+      m_binary ("mip6d"),
+      m_conf_path ("/etc/mip6d.conf")
   {
   }
 
@@ -70,31 +77,94 @@ public:
     return GetTypeId ();
   }
 
+  // addresses are kept in binary form and only formatted by RenderConfig
+  typedef struct
+  {
+    Ipv6Address m_addr;
+    uint8_t m_plen;
+  } prefix_t;
+
   typedef struct
   {
-    std::string m_mn_id;
-    std::string m_lma_addr;
-    std::string m_home_prefix;
+    Mac48Address m_mn_id;
+    Ipv6Address m_lma_addr;
+    prefix_t m_home_prefix;
   } pmipMNprofile_t;
 
+  // m_count profiles generated at render time: the n-th one gets
+  // m_base_mn_id + n and m_base_home_prefix + n * m_stride prefixes
+  typedef struct
+  {
+    Mac48Address m_base_mn_id;
+    uint32_t m_count;
+    uint32_t m_stride;
+    Ipv6Address m_lma_addr;
+    prefix_t m_base_home_prefix;
+  } pmipMNrange_t;
+
   bool m_haenable;
-  std::string m_ha_homenet_if;
   bool m_mrenable;
+  bool m_cnenable;
   bool m_magenable;
   bool m_debug;
-  double m_ifinit_delay;
   bool m_usemanualconf;
   bool m_dsmip6enable;
+  // DoRouteOptimizationMN
+  bool m_ro_mn;
+  bool m_has_ha_served_pfx;
+  bool m_has_mn_ha_addr;
+  bool m_has_mr_home_addr;
+  bool m_has_mag_egress_gaddr;
+  // mip6d -d, and DebugLevel when m_debug; 0 for no debug output
+  uint32_t m_debug_level;
+  // bytes of debug log kept in memory, 0 to let mip6d write its output
+  uint32_t m_log_ring;
+  double m_ifinit_delay;
+  std::string m_ha_homenet_if;
   std::string m_binary;
-  std::string m_ha_served_pfx;
-  std::vector<std::string> *m_mr_mobile_pfx;
-  std::vector<std::string> *m_mr_egress_if;
-  std::string m_mn_ha_addr;
-  std::string m_mr_home_addr;
+  prefix_t m_ha_served_pfx;
+  std::vector<prefix_t> m_mr_mobile_pfx;
+  std::vector<std::string> m_mr_egress_if;
+  Ipv6Address m_mn_ha_addr;
+  prefix_t m_mr_home_addr;
   std::string m_lma_mag_ifname;
-  std::string m_mag_egress_gaddr;
+  Ipv6Address m_mag_egress_gaddr;
   std::string m_mag_egress_ifname;
-  std::vector<pmipMNprofile_t> *m_mag_mn_profiles;
+  std::vector<pmipMNprofile_t> m_mag_mn_profiles;
+  std::vector<pmipMNrange_t> m_mag_mn_ranges;
+  // path given to mip6d -c, as seen from inside the node
+  std::string m_conf_path;
+
+  static prefix_t
+  MakePrefix (Ipv6Address addr, Ipv6Prefix plen)
+  {
+    prefix_t prefix;
+    prefix.m_addr = addr;
+    prefix.m_plen = plen.GetPrefixLength ();
+    return prefix;
+  }
+
+  /**
+   * \returns the bytes held by this configuration, heap included
+   */
+  uint32_t
+  GetMemoryUsage (void) const
+  {
+    uint32_t bytes = sizeof (*this);
+    bytes += m_mr_mobile_pfx.capacity () * sizeof (prefix_t);
+    bytes += m_mr_egress_if.capacity () * sizeof (std::string);
+    for (std::vector<std::string>::const_iterator i = m_mr_egress_if.begin ();
+         i != m_mr_egress_if.end (); ++i)
+      {
+        bytes += HeapBytes (*i);
+      }
+    bytes += m_mag_mn_profiles.capacity () * sizeof (pmipMNprofile_t);
+    bytes += m_mag_mn_ranges.capacity () * sizeof (pmipMNrange_t);
+    bytes += HeapBytes (m_ha_homenet_if) + HeapBytes (m_binary);
+    bytes += HeapBytes (m_lma_mag_ifname) + HeapBytes (m_mag_egress_ifname);
+    bytes += HeapBytes (m_conf_path);
+    return bytes;
+  }
 
   virtual void
   Print (std::ostream& os) const
@@ -104,6 +174,15 @@ public:
        << "KeyMngMobCapability disabled;" << std::endl
        << "# EOF" << std::endl;
   }
+
+private:
+  // short strings live inside std::string itself (SSO), up to the
+  // capacity of an empty string, whatever the library
+  static uint32_t
+  HeapBytes (const std::string &str)
+  {
+    return str.capacity () > std::string ().capacity () ? str.capacity () + 1 : 0;
+  }
 };
 std::ostream& operator << (std::ostream& os, Mip6dConfig const& config)
 {
@@ -111,9 +190,264 @@ std::ostream& operator << (std::ostream& os, Mip6dConfig const& config)
   return os;
 }
 
+static std::ostream&
+operator << (std::ostream& os, Mip6dConfig::prefix_t const& prefix)
+{
+  prefix.m_addr.Print (os);
+  os << "/" << (uint32_t)prefix.m_plen;
+  return os;
+}
+
+
+// Create the spool directory of shared configurations, if needed.
+// \returns its absolute path
+static std::string
+PrepareConfigSpool (std::string spool)
+{
+  if (spool[0] != '/')
+    {
+      char cwd[PATH_MAX];
+      if (::getcwd (cwd, sizeof (cwd)))
+        {
+          spool = std::string (cwd) + "/" + spool;
+        }
+    }
+
+  ::mkdir (spool.c_str (), S_IRWXU | S_IRWXG);
+  ::mkdir ((spool + "/etc").c_str (), S_IRWXU | S_IRWXG);
+  return spool;
+}
+
+// FNV-1a, stable across runs so that shared file names are reproducible
+static uint64_t
+HashConfig (const std::string &conf)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (std::string::const_iterator i = conf.begin (); i != conf.end (); ++i)
+    {
+      hash ^= (uint8_t)(*i);
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
 
 Mip6dHelper::Mip6dHelper ()
+  : m_spoolDir ("files-mip6d"),
+    m_sharing (CONFIG_SHARING_NONE),
+    m_renderedConfigs (0),
+    m_renderThreads (1),
+    m_deferredConfig (false),
+    m_handoverTracing (false)
+{
+  m_startPolicy = CreateObject<Mip6dLinearStartPolicy> ();
+  for (uint32_t i = 0; i < ROLE_COUNT; i++)
+    {
+      m_stackSize[i] = 1 << 16;
+    }
+}
+
+void
+Mip6dHelper::SetStartPolicy (Ptr<Mip6dStartPolicy> policy)
+{
+  m_startPolicy = policy;
+}
+
+Ptr<Mip6dStartPolicy>
+Mip6dHelper::GetStartPolicy (void) const
+{
+  return m_startPolicy;
+}
+
+Time
+Mip6dHelper::GetLastStartTime (void) const
+{
+  return m_startPolicy->GetLastStartTime ();
+}
+
+void
+Mip6dHelper::SetStackSize (enum Role role, uint32_t stackSize)
+{
+  NS_ASSERT (role < ROLE_COUNT);
+  m_stackSize[role] = stackSize;
+}
+
+Ptr<Mip6dConvergenceMonitor>
+Mip6dHelper::EnableConvergenceMonitor (void)
+{
+  if (!m_convergence)
+    {
+      m_convergence = CreateObject<Mip6dConvergenceMonitor> ();
+    }
+  return m_convergence;
+}
+
+Ptr<Mip6dConvergenceMonitor>
+Mip6dHelper::GetConvergenceMonitor (void) const
+{
+  return m_convergence;
+}
+
+void
+Mip6dHelper::EnableHandoverTracing (void)
+{
+  m_handoverTracing = true;
+}
+
+Ptr<Mip6dBindingSampler>
+Mip6dHelper::EnableBindingSampler (void)
+{
+  if (!m_bindingSampler)
+    {
+      m_bindingSampler = CreateObject<Mip6dBindingSampler> ();
+    }
+  return m_bindingSampler;
+}
+
+Ptr<Mip6dBindingSampler>
+Mip6dHelper::GetBindingSampler (void) const
+{
+  return m_bindingSampler;
+}
+
+Ptr<Mip6FlowMonitor>
+Mip6dHelper::EnableFlowMonitor (void)
+{
+  if (!m_flowMonitor)
+    {
+      m_flowMonitor = CreateObject<Mip6FlowMonitor> ();
+    }
+  return m_flowMonitor;
+}
+
+Ptr<Mip6FlowMonitor>
+Mip6dHelper::GetFlowMonitor (void) const
+{
+  return m_flowMonitor;
+}
+
+enum Mip6dHelper::Role
+Mip6dHelper::GetRole (Ptr<Node> node)
+{
+  Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig> ();
+  if (!mip6d_conf)
+    {
+      return ROLE_MN;
+    }
+  if (mip6d_conf->m_haenable)
+    {
+      return ROLE_HA;
+    }
+  else if (mip6d_conf->m_magenable)
+    {
+      return ROLE_MAG;
+    }
+  else if (mip6d_conf->m_mrenable)
+    {
+      return ROLE_MR;
+    }
+  else if (mip6d_conf->m_cnenable)
+    {
+      return ROLE_CN;
+    }
+  return ROLE_MN;
+}
+
+void
+Mip6dHelper::ShareIdenticalConfig (ConfigSharing mode, std::string spoolDir)
+{
+  m_sharing = mode;
+  m_spoolDir = spoolDir;
+  m_spoolPath = "";
+}
+
+void
+Mip6dHelper::SetRenderThreads (uint32_t threads)
+{
+  m_renderThreads = threads;
+}
+
+void
+Mip6dHelper::DeferConfigGeneration (Time lead)
+{
+  m_deferredConfig = true;
+  m_deferredLead = lead;
+}
+
+uint32_t
+Mip6dHelper::GetUniqueConfigCount (void) const
+{
+  return m_sharedConfigs.size ();
+}
+
+uint32_t
+Mip6dHelper::GetConfigMemoryUsage (Ptr<Node> node)
+{
+  Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig> ();
+  if (!mip6d_conf)
+    {
+      return 0;
+    }
+  return mip6d_conf->GetMemoryUsage ();
+}
+
+void
+Mip6dHelper::PrintConfigReport (std::ostream &os) const
+{
+  os << "mip6d.conf: " << m_renderedConfigs << " node(s), "
+     << m_sharedConfigs.size () << " unique configuration(s)" << std::endl;
+  for (std::map<std::string, std::string>::const_iterator i = m_sharedConfigs.begin ();
+       i != m_sharedConfigs.end (); ++i)
+    {
+      os << "  " << i->second << " (" << i->first.size () << " bytes)" << std::endl;
+    }
+}
+
+// Write one copy per distinct content into the spool, and link the node's
+// mip6d.conf to it: DCE only opens files under files-<id>/, but the host
+// follows the link out of it
+void
+Mip6dHelper::ShareConfig (Ptr<Node> node, const std::string &rendered)
 {
+  // once per helper, not per node; the path is absolute so that a later
+  // chdir does not break the links
+  if (m_spoolPath.empty ())
+    {
+      m_spoolPath = PrepareConfigSpool (m_spoolDir);
+    }
+  const std::string &spool = m_spoolPath;
+
+  std::map<std::string, std::string>::iterator it = m_sharedConfigs.find (rendered);
+  if (it == m_sharedConfigs.end ())
+    {
+      std::ostringstream conf_path;
+      conf_path << "/etc/mip6d-" << std::hex << HashConfig (rendered)
+                << std::dec << "-" << m_sharedConfigs.size () << ".conf";
+      it = m_sharedConfigs.insert (std::make_pair (rendered, conf_path.str ())).first;
+
+      // a fresh file, not one still linked by an earlier simulation
+      ::unlink ((spool + it->second).c_str ());
+      std::ofstream conf;
+      conf.open ((spool + it->second).c_str ());
+      conf << rendered;
+      conf.close ();
+    }
+
+  std::stringstream conf_dir;
+  conf_dir << "files-" << node->GetId () << "";
+  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
+  conf_dir << "/etc/";
+  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
+
+  std::string conf_file = conf_dir.str () + "mip6d.conf";
+  ::unlink (conf_file.c_str ());
+  std::string shared = spool + it->second;
+  int status = m_sharing == CONFIG_SHARING_HARDLINK
+    ? ::link (shared.c_str (), conf_file.c_str ())
+    : ::symlink (shared.c_str (), conf_file.c_str ());
+  if (status != 0)
+    {
+      NS_FATAL_ERROR ("could not link " << conf_file << " to " << shared);
+    }
 }
 
 void
@@ -135,16 +469,13 @@ Mip6dHelper::EnableHA (NodeContainer nodes, const char *ifname)
         }
       mip6d_conf->m_haenable = true;
       mip6d_conf->m_ha_homenet_if = ifname;
-
-      Ptr<LinuxSocketFdFactory> kern = nodes.Get (i)->GetObject<LinuxSocketFdFactory>();
-      Simulator::ScheduleWithContext (nodes.Get (i)->GetId (), Seconds (0.1),
-                                      MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                                 ".net.ipv6.conf.all.forwarding", "1"));
-      Simulator::ScheduleWithContext (nodes.Get (i)->GetId (), Seconds (0.1),
-                                      MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                                 ".net.ipv6.conf.all.proxy_ndp", "1"));
     }
 
+  KernelConfigHelper kernel;
+  kernel.AddSysctl (nodes, ".net.ipv6.conf.all.forwarding", "1");
+  kernel.AddSysctl (nodes, ".net.ipv6.conf.all.proxy_ndp", "1");
+  kernel.Install (Seconds (0.1));
+
   return;
 }
 
@@ -159,11 +490,8 @@ Mip6dHelper::AddHaServedPrefix (Ptr<Node> node,
       node->AggregateObject (mip6d_conf);
     }
 
-  std::ostringstream oss;
-  prefix.Print (oss);
-  oss << "/" << (uint32_t)plen.GetPrefixLength ();
-
-  mip6d_conf->m_ha_served_pfx = oss.str ();
+  mip6d_conf->m_ha_served_pfx = Mip6dConfig::MakePrefix (prefix, plen);
+  mip6d_conf->m_has_ha_served_pfx = true;
 
   return;
 }
@@ -182,13 +510,45 @@ Mip6dHelper::EnableMR (NodeContainer nodes)
           nodes.Get (i)->AggregateObject (mip6d_conf);
         }
       mip6d_conf->m_mrenable = true;
+    }
+
+  KernelConfigHelper kernel;
+  kernel.AddSysctl (nodes, ".net.ipv6.conf.all.forwarding", "1");
+  kernel.Install (Seconds (0.1));
 
-      Ptr<LinuxSocketFdFactory> kern = nodes.Get (i)->GetObject<LinuxSocketFdFactory>();
-      Simulator::ScheduleWithContext (nodes.Get (i)->GetId (), Seconds (0.1),
-                                      MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                                 ".net.ipv6.conf.all.forwarding", "1"));
+  return;
+}
+
+void
+Mip6dHelper::EnableRouteOptimization (NodeContainer nodes, bool enable)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
+      if (!mip6d_conf)
+        {
+          mip6d_conf = CreateObject<Mip6dConfig> ();
+          nodes.Get (i)->AggregateObject (mip6d_conf);
+        }
+      mip6d_conf->m_ro_mn = enable;
     }
+  return;
+}
 
+// CorrespondentNode
+void
+Mip6dHelper::EnableCN (NodeContainer nodes)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
+      if (!mip6d_conf)
+        {
+          mip6d_conf = CreateObject<Mip6dConfig> ();
+          nodes.Get (i)->AggregateObject (mip6d_conf);
+        }
+      mip6d_conf->m_cnenable = true;
+    }
   return;
 }
 
@@ -203,11 +563,7 @@ Mip6dHelper::AddMobileNetworkPrefix (Ptr<Node> node,
       node->AggregateObject (mip6d_conf);
     }
 
-  std::ostringstream oss;
-  prefix.Print (oss);
-  oss << "/" << (uint32_t)plen.GetPrefixLength ();
-
-  mip6d_conf->m_mr_mobile_pfx->push_back (oss.str ());
+  mip6d_conf->m_mr_mobile_pfx.push_back (Mip6dConfig::MakePrefix (prefix, plen));
 
   return;
 }
@@ -222,7 +578,7 @@ Mip6dHelper::AddEgressInterface (Ptr<Node> node, const char *ifname)
       node->AggregateObject (mip6d_conf);
     }
 
-  mip6d_conf->m_mr_egress_if->push_back (std::string (ifname));
+  mip6d_conf->m_mr_egress_if.push_back (std::string (ifname));
 
   return;
 }
@@ -237,9 +593,8 @@ Mip6dHelper::AddHomeAgentAddress (Ptr<Node> node, Ipv6Address addr)
       node->AggregateObject (mip6d_conf);
     }
 
-  std::ostringstream oss;
-  addr.Print (oss);
-  mip6d_conf->m_mn_ha_addr = oss.str ();
+  mip6d_conf->m_mn_ha_addr = addr;
+  mip6d_conf->m_has_mn_ha_addr = true;
 
   return;
 }
@@ -255,10 +610,8 @@ Mip6dHelper::AddHomeAddress (Ptr<Node> node,
       node->AggregateObject (mip6d_conf);
     }
 
-  std::ostringstream oss;
-  addr.Print (oss);
-  oss << "/" << (uint32_t)plen.GetPrefixLength ();
-  mip6d_conf->m_mr_home_addr = oss.str ();
+  mip6d_conf->m_mr_home_addr = Mip6dConfig::MakePrefix (addr, plen);
+  mip6d_conf->m_has_mr_home_addr = true;
 
   return;
 }
@@ -291,9 +644,8 @@ Mip6dHelper::EnableMAG (Ptr<Node> node,
     }
 
   mip6d_conf->m_magenable = true;
-  std::ostringstream oss;
-  addr.Print (oss);
-  mip6d_conf->m_mag_egress_gaddr = oss.str ();
+  mip6d_conf->m_mag_egress_gaddr = addr;
+  mip6d_conf->m_has_mag_egress_gaddr = true;
   mip6d_conf->m_mag_egress_ifname = ifname;
 }
 
@@ -309,22 +661,37 @@ Mip6dHelper::AddMNProfileMAG (Ptr<Node> node, Mac48Address mn_id,
       node->AggregateObject (mip6d_conf);
     }
 
-  std::ostringstream oss;
   Mip6dConfig::pmipMNprofile_t profile;
+  profile.m_mn_id = mn_id;
+  profile.m_lma_addr = lma_addr;
+  profile.m_home_prefix = Mip6dConfig::MakePrefix (home_pfx, home_plen);
 
-  oss << mn_id;
-  profile.m_mn_id = oss.str ();
+  mip6d_conf->m_mag_mn_profiles.push_back (profile);
 
-  oss.str ("");
-  lma_addr.Print (oss);
-  profile.m_lma_addr = oss.str ();
+  return;
+}
+
+void
+Mip6dHelper::AddMNProfileRangeMAG (Ptr<Node> node, Mac48Address base_mn_id,
+                                   uint32_t count, Ipv6Address lma_addr,
+                                   Ipv6Address base_home_pfx, Ipv6Prefix home_plen,
+                                   uint32_t stride)
+{
+  Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig>();
+  if (!mip6d_conf)
+    {
+      mip6d_conf = CreateObject<Mip6dConfig> ();
+      node->AggregateObject (mip6d_conf);
+    }
 
-  oss.str ("");
-  home_pfx.Print (oss);
-  oss << "/" << (uint32_t)home_plen.GetPrefixLength ();
-  profile.m_home_prefix = oss.str ();
+  Mip6dConfig::pmipMNrange_t range;
+  range.m_base_mn_id = base_mn_id;
+  range.m_count = count;
+  range.m_stride = stride;
+  range.m_lma_addr = lma_addr;
+  range.m_base_home_prefix = Mip6dConfig::MakePrefix (base_home_pfx, home_plen);
 
-  mip6d_conf->m_mag_mn_profiles->push_back (profile);
+  mip6d_conf->m_mag_mn_ranges.push_back (range);
 
   return;
 }
@@ -363,6 +730,61 @@ Mip6dHelper::EnableDebug (NodeContainer nodes)
   return;
 }
 
+void
+Mip6dHelper::SetDebugLevel (NodeContainer nodes, uint32_t level)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
+      if (!mip6d_conf)
+        {
+          mip6d_conf = CreateObject<Mip6dConfig> ();
+          nodes.Get (i)->AggregateObject (mip6d_conf);
+        }
+      mip6d_conf->m_debug_level = level;
+    }
+  return;
+}
+
+void
+Mip6dHelper::EnableLogRing (NodeContainer nodes, uint32_t capacity)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
+      if (!mip6d_conf)
+        {
+          mip6d_conf = CreateObject<Mip6dConfig> ();
+          nodes.Get (i)->AggregateObject (mip6d_conf);
+        }
+      mip6d_conf->m_log_ring = capacity;
+    }
+  return;
+}
+
+void
+Mip6dHelper::DumpLogRing (Ptr<Node> node, std::ostream &os)
+{
+  Ptr<Mip6dLogRing> ring = node->GetObject<Mip6dLogRing> ();
+  if (!ring)
+    {
+      return;
+    }
+  os << "---- node " << node->GetId () << " mip6d log (" << ring->GetNWritten ()
+     << " bytes) ----" << std::endl;
+  ring->Dump (os);
+  os << "---- end of node " << node->GetId () << " mip6d log ----" << std::endl;
+}
+
+void
+Mip6dHelper::DumpLogRings (std::ostream &os)
+{
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      DumpLogRing (*i, os);
+    }
+}
+
 void
 Mip6dHelper::SetInterfaceInitialInitDelay (NodeContainer nodes, double delay)
 {
@@ -387,7 +809,7 @@ Mip6dHelper::UseManualConfig (NodeContainer nodes)
       Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
       if (!mip6d_conf)
         {
-          mip6d_conf = new Mip6dConfig ();
+          mip6d_conf = CreateObject<Mip6dConfig> ();
           nodes.Get (i)->AggregateObject (mip6d_conf);
         }
       mip6d_conf->m_usemanualconf = true;
@@ -403,7 +825,7 @@ Mip6dHelper::SetBinary (NodeContainer nodes, std::string binary)
       Ptr<Mip6dConfig> mip6d_conf = nodes.Get (i)->GetObject<Mip6dConfig> ();
       if (!mip6d_conf)
         {
-          mip6d_conf = new Mip6dConfig ();
+          mip6d_conf = CreateObject<Mip6dConfig> ();
           nodes.Get (i)->AggregateObject (mip6d_conf);
         }
       mip6d_conf->m_binary = binary;
@@ -411,28 +833,61 @@ Mip6dHelper::SetBinary (NodeContainer nodes, std::string binary)
   return;
 }
 
-void
-Mip6dHelper::GenerateConfig (Ptr<Node> node)
+// base + n, as 48 bits big-endian
+static Mac48Address
+NthMac48Address (Mac48Address base, uint64_t n)
 {
-  Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig> ();
+  uint8_t buf[6];
+  base.CopyTo (buf);
+  for (int k = 5; k >= 0 && n; k--)
+    {
+      n += buf[k];
+      buf[k] = n & 0xff;
+      n >>= 8;
+    }
+  Mac48Address mac;
+  mac.CopyFrom (buf);
+  return mac;
+}
 
-  if (mip6d_conf->m_usemanualconf)
+// base + n, counted in units of the prefix length
+static Ipv6Address
+NthIpv6Prefix (Ipv6Address base, uint8_t plen, uint64_t n)
+{
+  uint8_t buf[16];
+  base.GetBytes (buf);
+  uint32_t shift = 128 - plen;
+  uint32_t bit = shift % 8;
+  uint32_t carry = 0;
+  for (int k = 15 - (int)(shift / 8); k >= 0 && (n || carry); k--)
     {
-      return;
+      uint32_t sum = buf[k] + carry + ((n << bit) & 0xff);
+      n = n >> (8 - bit);
+      bit = 0;
+      buf[k] = sum & 0xff;
+      carry = sum >> 8;
     }
+  return Ipv6Address (buf);
+}
 
-  // config generation
-  std::stringstream conf_dir, conf_file;
-  // FIXME XXX
-  conf_dir << "files-" << node->GetId () << "";
-  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
-  conf_dir << "/etc/";
-  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
+static void
+RenderMNProfile (const Mip6dConfig::pmipMNprofile_t &profile, std::ostream &conf)
+{
+  conf << "MNIdentifier \"" << profile.m_mn_id <<"\" {" << std::endl;
+  conf << "       PMIPEnabled 1;" << std::endl;
+  conf << "       LMAAddress " << profile.m_lma_addr << ";" << std::endl;
+  conf << "       HomeNetworkPrefix1 " << profile.m_home_prefix << ";" << std::endl;
+  conf << "       PMIPInterface1 \"sim0(XXX)\";" << std::endl;
+  conf << "       HomePrefixLifetime 460.0;" << std::endl;
+  conf << "}" << std::endl;
+}
 
-  conf_file << conf_dir.str () << "/mip6d.conf";
-  std::ofstream conf;
-  conf.open (conf_file.str ().c_str ());
+// path of the log ring FIFO inside each node
+static const char *LOG_RING_FIFO = "/var/log/mip6d-debug";
 
+static void
+RenderConfig (const Mip6dConfig *mip6d_conf, std::ostream &conf)
+{
   if (mip6d_conf->m_haenable)
     {
       conf << "NodeConfig HA;" << std::endl
@@ -444,7 +899,7 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
       if (!mip6d_conf->m_lma_mag_ifname.empty ())
         conf << "LMAInterfaceMAG \"" << mip6d_conf->m_lma_mag_ifname << "\";" << std::endl;
 
-      if (!mip6d_conf->m_ha_served_pfx.empty ())
+      if (mip6d_conf->m_has_ha_served_pfx)
         conf << "HaServedPrefix " << mip6d_conf->m_ha_served_pfx << ";" << std::endl;
 
       if (mip6d_conf->m_dsmip6enable)
@@ -468,21 +923,41 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
            << "MnMaxHaBindingLife 60;" << std::endl;
 
       conf << "MAGInterfaceLMA \"" << mip6d_conf->m_mag_egress_ifname << "\";" << std::endl;
-      conf << "MAGEgressGlobalAddress " << mip6d_conf->m_mag_egress_gaddr << ";" << std::endl;
+      conf << "MAGEgressGlobalAddress ";
+      if (mip6d_conf->m_has_mag_egress_gaddr)
+        mip6d_conf->m_mag_egress_gaddr.Print (conf);
+      conf << ";" << std::endl;
 
 
-      for (std::vector<Mip6dConfig::pmipMNprofile_t>::iterator i = mip6d_conf->m_mag_mn_profiles->begin (); 
-           i != mip6d_conf->m_mag_mn_profiles->end (); ++i)
+      for (std::vector<Mip6dConfig::pmipMNprofile_t>::const_iterator i = mip6d_conf->m_mag_mn_profiles.begin ();
+           i != mip6d_conf->m_mag_mn_profiles.end (); ++i)
+        {
+          RenderMNProfile (*i, conf);
+        }
+
+      // ranges are expanded while writing, never stored profile by profile
+      for (std::vector<Mip6dConfig::pmipMNrange_t>::const_iterator r = mip6d_conf->m_mag_mn_ranges.begin ();
+           r != mip6d_conf->m_mag_mn_ranges.end (); ++r)
         {
-          conf << "MNIdentifier \"" << (*i).m_mn_id <<"\" {" << std::endl;
-          conf << "       PMIPEnabled 1;" << std::endl;
-          conf << "       LMAAddress " << (*i).m_lma_addr << ";" << std::endl;
-          conf << "       HomeNetworkPrefix1 " << (*i).m_home_prefix << ";" << std::endl;
-          conf << "       PMIPInterface1 \"sim0(XXX)\";" << std::endl;
-          conf << "       HomePrefixLifetime 460.0;" << std::endl;
-          conf << "}" << std::endl;
+          Mip6dConfig::pmipMNprofile_t profile;
+          profile.m_lma_addr = (*r).m_lma_addr;
+          profile.m_home_prefix.m_plen = (*r).m_base_home_prefix.m_plen;
+          for (uint32_t n = 0; n < (*r).m_count; n++)
+            {
+              profile.m_mn_id = NthMac48Address ((*r).m_base_mn_id, n);
+              profile.m_home_prefix.m_addr = NthIpv6Prefix ((*r).m_base_home_prefix.m_addr,
+                                                            (*r).m_base_home_prefix.m_plen,
+                                                            (uint64_t)n * (*r).m_stride);
+              RenderMNProfile (profile, conf);
+            }
         }
     }
+  // Correspondent node of route optimized MNs
+  else if (mip6d_conf->m_cnenable)
+    {
+      conf << "NodeConfig CN;" << std::endl
+           << "DoRouteOptimizationCN enabled;" << std::endl;
+    }
   // CMIP-MN or MR (NEMO)
   else
     {
@@ -493,13 +968,15 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
 
       conf << "NodeConfig MN;" << std::endl
            << "DoRouteOptimizationCN enabled;" << std::endl
-           << "DoRouteOptimizationMN disabled;" << std::endl
+           << "DoRouteOptimizationMN "
+           << (mip6d_conf->m_ro_mn && !mip6d_conf->m_mrenable ? "enabled" : "disabled")
+           << ";" << std::endl
            << "UseCnBuAck disabled;" << std::endl
            << "MnDiscardHaParamProb enabled;" << std::endl
            << "MobRtrUseExplicitMode enabled;" << std::endl;
 
-      for (std::vector<std::string>::iterator i = mip6d_conf->m_mr_egress_if->begin ();
-           i != mip6d_conf->m_mr_egress_if->end (); ++i)
+      for (std::vector<std::string>::const_iterator i = mip6d_conf->m_mr_egress_if.begin ();
+           i != mip6d_conf->m_mr_egress_if.end (); ++i)
         {
           if (mip6d_conf->m_dsmip6enable)
             {
@@ -529,17 +1006,22 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
         {
           conf << "	IsMobRtr enabled;" << std::endl;
         }
-      conf << "	HomeAgentAddress " << mip6d_conf->m_mn_ha_addr << ";" << std::endl;
+      conf << "	HomeAgentAddress ";
+      if (mip6d_conf->m_has_mn_ha_addr)
+        mip6d_conf->m_mn_ha_addr.Print (conf);
+      conf << ";" << std::endl;
 
-      conf << "	HomeAddress " << mip6d_conf->m_mr_home_addr;
+      conf << "	HomeAddress ";
+      if (mip6d_conf->m_has_mr_home_addr)
+        conf << mip6d_conf->m_mr_home_addr;
       
       if (mip6d_conf->m_mrenable)
         {
           conf << "(";
-          for (std::vector<std::string>::iterator i = mip6d_conf->m_mr_mobile_pfx->begin ();
-               i != mip6d_conf->m_mr_mobile_pfx->end (); ++i)
+          for (std::vector<Mip6dConfig::prefix_t>::const_iterator i = mip6d_conf->m_mr_mobile_pfx.begin ();
+               i != mip6d_conf->m_mr_mobile_pfx.end (); ++i)
             {
-              if (i != mip6d_conf->m_mr_mobile_pfx->begin ())
+              if (i != mip6d_conf->m_mr_mobile_pfx.begin ())
                 {
                   conf << "," ;
                 }
@@ -553,7 +1035,11 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
 
   if (mip6d_conf->m_debug)
     {
-      conf << "DebugLevel 10;" << std::endl;
+      conf << "DebugLevel " << mip6d_conf->m_debug_level << ";" << std::endl;
+    }
+  if (mip6d_conf->m_log_ring)
+    {
+      conf << "DebugLogFile \"" << LOG_RING_FIFO << "\";" << std::endl;
     }
 
   if (mip6d_conf->m_ifinit_delay)
@@ -564,10 +1050,138 @@ Mip6dHelper::GenerateConfig (Ptr<Node> node)
     }
 
   conf << *mip6d_conf;
+}
+
+static void
+WriteConfigFile (uint32_t nodeId, const std::string &rendered)
+{
+  std::stringstream conf_dir, conf_file;
+  // FIXME XXX
+  conf_dir << "files-" << nodeId << "";
+  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
+  conf_dir << "/etc/";
+  ::mkdir (conf_dir.str ().c_str (), S_IRWXU | S_IRWXG);
+
+  conf_file << conf_dir.str () << "/mip6d.conf";
+  std::ofstream conf;
+  conf.open (conf_file.str ().c_str ());
+  conf << rendered;
   conf.close ();
+}
 
+// Work shared by the rendering threads of Mip6dHelper::GenerateConfigs.
+// Workers only touch raw Mip6dConfig pointers and their own output slot:
+// Ptr<> reference counts and GetObject () are not thread-safe.
+struct RenderJob
+{
+  std::vector<const Mip6dConfig *> confs;
+  std::vector<uint32_t> nodeIds;
+  std::vector<std::string> rendered;
+  bool writeFiles;
+  std::atomic<uint32_t> next;
+};
+
+static void
+RenderWorker (RenderJob *job)
+{
+  for (uint32_t i = job->next++; i < job->confs.size (); i = job->next++)
+    {
+      std::ostringstream conf;
+      RenderConfig (job->confs[i], conf);
+      job->rendered[i] = conf.str ();
+      if (job->writeFiles)
+        {
+          WriteConfigFile (job->nodeIds[i], job->rendered[i]);
+          std::string ().swap (job->rendered[i]);
+        }
+    }
 }
 
+// Render a configuration at the time its daemon is about to start
+static void
+DeferredConfig (Ptr<Mip6dConfig> mip6d_conf, uint32_t nodeId)
+{
+  std::ostringstream conf;
+  RenderConfig (PeekPointer (mip6d_conf), conf);
+  WriteConfigFile (nodeId, conf.str ());
+}
+
+void
+Mip6dHelper::GenerateConfig (Ptr<Node> node)
+{
+  Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig> ();
+
+  if (mip6d_conf->m_usemanualconf)
+    {
+      return;
+    }
+
+  std::ostringstream conf;
+  RenderConfig (PeekPointer (mip6d_conf), conf);
+  StoreConfig (node, conf.str ());
+}
+
+void
+Mip6dHelper::StoreConfig (Ptr<Node> node, const std::string &rendered)
+{
+  m_renderedConfigs++;
+  if (m_sharing != CONFIG_SHARING_NONE)
+    {
+      ShareConfig (node, rendered);
+      return;
+    }
+
+  WriteConfigFile (node->GetId (), rendered);
+}
+
+void
+Mip6dHelper::GenerateConfigs (NodeContainer c)
+{
+  std::vector<Ptr<Node> > nodes;
+  RenderJob job;
+
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<Mip6dConfig> mip6d_conf = (*i)->GetObject<Mip6dConfig> ();
+      if (!mip6d_conf)
+        {
+          mip6d_conf = CreateObject<Mip6dConfig> ();
+          (*i)->AggregateObject (mip6d_conf);
+        }
+      if (mip6d_conf->m_usemanualconf)
+        {
+          continue;
+        }
+      nodes.push_back (*i);
+      job.confs.push_back (PeekPointer (mip6d_conf));
+      job.nodeIds.push_back ((*i)->GetId ());
+    }
+
+  job.rendered.resize (nodes.size ());
+  job.writeFiles = (m_sharing == CONFIG_SHARING_NONE);
+  job.next = 0;
+
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < m_renderThreads && t < nodes.size (); t++)
+    {
+      workers.push_back (std::thread (&RenderWorker, &job));
+    }
+  for (uint32_t t = 0; t < workers.size (); t++)
+    {
+      workers[t].join ();
+    }
+
+  if (job.writeFiles)
+    {
+      m_renderedConfigs += nodes.size ();
+      return;
+    }
+  // sharing bookkeeping stays on the main thread
+  for (uint32_t i = 0; i < nodes.size (); i++)
+    {
+      StoreConfig (nodes[i], job.rendered[i]);
+    }
+}
 
 ApplicationContainer
 Mip6dHelper::Install (Ptr<Node> node)
@@ -586,16 +1200,21 @@ ApplicationContainer
 Mip6dHelper::Install (NodeContainer c)
 {
   ApplicationContainer apps;
+  bool parallel = m_renderThreads > 1 && !m_deferredConfig;
+  if (parallel)
+    {
+      GenerateConfigs (c);
+    }
   for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
     {
-      apps.Add (InstallPriv (*i));
+      apps.Add (InstallPriv (*i, !parallel));
     }
 
   return apps;
 }
 
 ApplicationContainer
-Mip6dHelper::InstallPriv (Ptr<Node> node)
+Mip6dHelper::InstallPriv (Ptr<Node> node, bool generate)
 {
   DceApplicationHelper process;
   ApplicationContainer apps;
@@ -603,19 +1222,76 @@ Mip6dHelper::InstallPriv (Ptr<Node> node)
   Ptr<Mip6dConfig> mip6d_conf = node->GetObject<Mip6dConfig> ();
   if (!mip6d_conf)
     {
-      mip6d_conf = new Mip6dConfig ();
+      mip6d_conf = CreateObject<Mip6dConfig> ();
       node->AggregateObject (mip6d_conf);
     }
-  GenerateConfig (node);
+  bool deferred = m_deferredConfig && !mip6d_conf->m_usemanualconf;
+  NS_ABORT_MSG_IF (deferred && m_sharing != CONFIG_SHARING_NONE,
+                   "deferred mip6d.conf generation can not share configurations");
+  if (!deferred && generate)
+    {
+      GenerateConfig (node);
+    }
 
   process.ResetArguments ();
   process.SetBinary (mip6d_conf->m_binary);
-  process.ParseArguments ("-c /etc/mip6d.conf -d 10");
-  process.SetStackSize (1 << 16);
+  std::ostringstream args;
+  args << "-c " << mip6d_conf->m_conf_path;
+  if (mip6d_conf->m_debug_level)
+    {
+      args << " -d " << mip6d_conf->m_debug_level;
+    }
+  process.ParseArguments (args.str ());
+  enum Role role = GetRole (node);
+  process.SetStackSize (m_stackSize[role]);
+  if (m_convergence && (role == ROLE_MN || role == ROLE_MR))
+    {
+      m_convergence->Watch (node);
+    }
+  if (m_handoverTracing && (role == ROLE_MN || role == ROLE_MR))
+    {
+      Mip6dHandoverTracer::Install (node);
+    }
+  if (m_bindingSampler && role == ROLE_HA)
+    {
+      m_bindingSampler->Watch (node);
+    }
+  if (m_flowMonitor && (role == ROLE_MN || role == ROLE_CN))
+    {
+      m_flowMonitor->Install (node);
+    }
+  else if (m_flowMonitor && role != ROLE_MAG)
+    {
+      m_flowMonitor->WatchTunnel (node);
+    }
   apps.Add (process.Install (node));
-  apps.Get (0)->SetStartTime (Seconds (1.0 + 0.01 * node->GetId ()));
+  Time start = m_startPolicy->GetStartTime (node);
+  apps.Get (0)->SetStartTime (start);
   node->AddApplication (apps.Get (0));
 
+  if (mip6d_conf->m_log_ring && !node->GetObject<Mip6dLogRing> ())
+    {
+      std::ostringstream fifo;
+      fifo << "files-" << node->GetId ();
+      ::mkdir (fifo.str ().c_str (), S_IRWXU | S_IRWXG);
+      fifo << "/var";
+      ::mkdir (fifo.str ().c_str (), S_IRWXU | S_IRWXG);
+      fifo << "/log";
+      ::mkdir (fifo.str ().c_str (), S_IRWXU | S_IRWXG);
+      Ptr<Mip6dLogRing> ring = CreateObject<Mip6dLogRing> ();
+      ring->Start (fifo.str () + "/mip6d-debug", mip6d_conf->m_log_ring);
+      node->AggregateObject (ring);
+    }
+
+  // scheduled before the application start, so it runs first at that time
+  if (deferred)
+    {
+      Time at = start > m_deferredLead ? start - m_deferredLead : Seconds (0);
+      Simulator::ScheduleWithContext (node->GetId (), at,
+                                      &DeferredConfig, mip6d_conf,
+                                      node->GetId ());
+    }
+
   return apps;
 }
 
@@ -26,6 +26,14 @@
 #include "ns3/boolean.h"
 #include "ns3/ipv4-interface-container.h"
 #include "ns3/address-utils.h"
+#include "ns3/nstime.h"
+#include "mip6d-start-policy.h"
+#include "mip6d-convergence-monitor.h"
+#include "mip6d-handover-tracer.h"
+#include "mip6d-binding-sampler.h"
+#include "mip6-flow-monitor.h"
+#include <map>
+#include <string>
 
 namespace ns3 {
 
@@ -36,6 +44,29 @@ namespace ns3 {
 class Mip6dHelper
 {
 public:
+  /**
+   * How nodes with byte-identical mip6d.conf are pointed at one copy
+   */
+  enum ConfigSharing
+  {
+    CONFIG_SHARING_NONE,     /**< one file per node (default) */
+    CONFIG_SHARING_SYMLINK,  /**< files-<id>/etc/mip6d.conf is a symbolic link */
+    CONFIG_SHARING_HARDLINK, /**< files-<id>/etc/mip6d.conf is a hard link */
+  };
+
+  /**
+   * Role of a mip6d instance, as configured through this helper
+   */
+  enum Role
+  {
+    ROLE_HA,  /**< EnableHA () or EnableLMA () */
+    ROLE_MAG, /**< EnableMAG () */
+    ROLE_MN,  /**< mobile node */
+    ROLE_MR,  /**< EnableMR () */
+    ROLE_CN,  /**< EnableCN () */
+    ROLE_COUNT
+  };
+
   /**
    * Create a Mip6dHelper which is used to make life easier for people wanting
    * to use mip6d Applications.
@@ -96,25 +127,274 @@ public:
   void EnableMR (NodeContainer nodes);
   void EnableDSMIP6 (NodeContainer nodes);
 
+  // For route optimization
+  /**
+   * \brief Let mobile nodes optimize their routes (DoRouteOptimizationMN).
+   *
+   * After the return routability procedure with a correspondent node, a
+   * MN binds its care-of address there and exchanges packets with the CN
+   * directly instead of through the HA tunnel. By default MNs do not.
+   * Mobile routers are not affected: NEMO has no route optimization.
+   *
+   * \param nodes the mobile nodes
+   * \param enable whether to optimize routes
+   */
+  void EnableRouteOptimization (NodeContainer nodes, bool enable = true);
+  /**
+   * \brief Run mip6d as a correspondent node (NodeConfig CN).
+   *
+   * The daemon answers the return routability procedure and keeps the
+   * bindings of the MNs; a CN without it leaves their traffic routed
+   * through the HA.
+   *
+   * \param nodes the correspondent nodes
+   */
+  void EnableCN (NodeContainer nodes);
+
   // For PMIP
   void AddMNProfileMAG (Ptr<Node> node, Mac48Address mn_id, 
                         Ipv6Address lma_addr,
                         Ipv6Address home_pfx, Ipv6Prefix home_plen);
+  /**
+   * \brief Add \p count PMIP MN profiles to a MAG in one call.
+   *
+   * The n-th profile (from 0) uses the MN identifier \p base_mn_id + n and
+   * the home network prefix \p base_home_pfx + n * \p stride, counted in
+   * units of \p home_plen. The node keeps the range alone and expands it
+   * into profiles when its configuration is rendered: the rendered text
+   * still grows linearly with \p count.
+   *
+   * \param node the MAG
+   * \param base_mn_id MAC address of the first MN
+   * \param count number of MNs
+   * \param lma_addr address of the LMA serving the MNs
+   * \param base_home_pfx home network prefix of the first MN
+   * \param home_plen home network prefix length
+   * \param stride prefix increment between two consecutive MNs
+   */
+  void AddMNProfileRangeMAG (Ptr<Node> node, Mac48Address base_mn_id,
+                             uint32_t count, Ipv6Address lma_addr,
+                             Ipv6Address base_home_pfx, Ipv6Prefix home_plen,
+                             uint32_t stride = 1);
   void EnableMAG (Ptr<Node> node, const char *ifname, Ipv6Address addr);
   void EnableLMA (Ptr<Node> node, const char *ifname);
 
   // Common
   void EnableDebug (NodeContainer nodes);
+  /**
+   * \brief Set the debug level of mip6d (-d, and DebugLevel with
+   * EnableDebug ()), 10 by default.
+   *
+   * At 0 no -d is given: mip6d writes no debug output at all and detaches
+   * as it does outside DCE. Use it on nodes which do not need a log in
+   * large scenarios, where log writes take much of the wall time.
+   *
+   * \param nodes the nodes
+   * \param level debug level, 0 for none
+   */
+  void SetDebugLevel (NodeContainer nodes, uint32_t level);
+  /**
+   * \brief Keep the debug log of mip6d in memory instead of on disk.
+   *
+   * mip6d writes its log (DebugLogFile) to a FIFO drained into a
+   * Mip6dLogRing aggregated to the node, which only keeps the last
+   * \p capacity bytes. Nothing is printed unless DumpLogRing () or
+   * DumpLogRings () is called, e.g. when a test fails.
+   *
+   * \param nodes the nodes
+   * \param capacity bytes kept per node
+   */
+  void EnableLogRing (NodeContainer nodes, uint32_t capacity = 64 * 1024);
+  /**
+   * \brief Print the log kept by the ring of a node, if any
+   * \param node the node
+   * \param os output stream
+   */
+  static void DumpLogRing (Ptr<Node> node, std::ostream &os);
+  /**
+   * \brief Print the log kept by the ring of every node
+   * \param os output stream
+   */
+  static void DumpLogRings (std::ostream &os);
   void SetInterfaceInitialInitDelay (NodeContainer nodes, double delay);
   void UseManualConfig (NodeContainer nodes);
   void SetBinary (NodeContainer nodes, std::string binary);
 
+  /**
+   * \brief Write each distinct mip6d.conf only once.
+   *
+   * One copy per distinct content is written into the spool directory,
+   * and files-<id>/etc/mip6d.conf of every node sharing it is a link to
+   * that copy, as \p mode says. A hard link needs the spool and the
+   * files-<id> directories on one file system.
+   *
+   * Only byte-identical configurations are shared: HAs, LMAs and MAGs
+   * configured alike share one copy, but MNs and MRs each have their own
+   * home address, so N of them still need N copies.
+   *
+   * \param mode how nodes refer to the shared copy
+   * \param spoolDir host directory holding the shared copies
+   */
+  void ShareIdenticalConfig (ConfigSharing mode = CONFIG_SHARING_SYMLINK,
+                             std::string spoolDir = "files-mip6d");
+  /**
+   * \returns the number of distinct configurations written so far
+   */
+  uint32_t GetUniqueConfigCount (void) const;
+  /**
+   * \brief Print how many configurations were rendered and shared
+   * \param os output stream
+   */
+  void PrintConfigReport (std::ostream &os) const;
+  /**
+   * \brief Memory held by the mip6d configuration aggregated to a node
+   * \param node the node
+   * \returns bytes used by the configuration object, heap included
+   */
+  static uint32_t GetConfigMemoryUsage (Ptr<Node> node);
+  /**
+   * \brief Render mip6d.conf of Install (NodeContainer) on a worker pool.
+   *
+   * All the configurations of the container are rendered (and, without
+   * sharing, written) by \p threads workers before the DCE applications
+   * are registered one by one on the main thread.
+   *
+   * \param threads number of workers, 1 (default) renders serially
+   */
+  void SetRenderThreads (uint32_t threads);
+  /**
+   * \brief Render mip6d.conf only when the daemon is about to start.
+   *
+   * Install () then only schedules an event, \p lead before the start
+   * time of each mip6d application, which renders and writes the
+   * configuration. Daemons that never start never cost a configuration.
+   *
+   * mip6d only reads its configuration from files-<id>/etc, so every
+   * daemon started needs one host file (or a link with
+   * ShareIdenticalConfig ()); deferring is the supported way to write
+   * it only when, and if, its daemon starts.
+   * Can not be combined with ShareIdenticalConfig (): Install () aborts
+   * when both are set.
+   *
+   * \param lead how long before the application start to render
+   */
+  void DeferConfigGeneration (Time lead = Seconds (0));
+
+  /**
+   * \brief Choose when the installed daemons start.
+   *
+   * The default, Mip6dLinearStartPolicy, starts node i at 1.0 + 0.01 * i
+   * seconds. Mip6dBatchStartPolicy, Mip6dJitterStartPolicy and
+   * Mip6dAllAtOnceStartPolicy trade the startup burst against the
+   * time it takes for every daemon to be running.
+   *
+   * \param policy the start policy
+   */
+  void SetStartPolicy (Ptr<Mip6dStartPolicy> policy);
+  /**
+   * \returns the start policy in use
+   */
+  Ptr<Mip6dStartPolicy> GetStartPolicy (void) const;
+  /**
+   * \returns the start time of the last daemon to start among those
+   * installed so far, i.e. when every daemon has started
+   */
+  Time GetLastStartTime (void) const;
+
+  /**
+   * \brief Set the stack size of the mip6d processes of a role
+   *
+   * The helper does not measure how much of it a daemon uses: DCE gives
+   * no access to the stack of a process it runs.
+   *
+   * \param role HA (or LMA), MAG, MN, MR or CN
+   * \param stackSize stack size in bytes (default 64 KiB)
+   */
+  void SetStackSize (enum Role role, uint32_t stackSize);
+
+  /**
+   * \brief Watch every MN and MR installed from now on for its first
+   * accepted Binding Acknowledgement.
+   *
+   * Hook the monitor's Converged trace to start measuring as soon as
+   * every mobile node is registered, instead of at a fixed time.
+   *
+   * \returns the monitor, shared by copies of this helper
+   */
+  Ptr<Mip6dConvergenceMonitor> EnableConvergenceMonitor (void);
+  /**
+   * \returns the convergence monitor, 0 if not enabled
+   */
+  Ptr<Mip6dConvergenceMonitor> GetConvergenceMonitor (void) const;
+
+  /**
+   * \brief Aggregate a Mip6dHandoverTracer to every MN and MR installed
+   * from now on.
+   *
+   * Its trace sources time the stages of each handover (L2 attach, RA,
+   * CoA configuration, BU, BA, first tunneled packet), and
+   * Mip6dHandoverTracer::PrintHandovers () reports them per node.
+   */
+  void EnableHandoverTracing (void);
+
+  /**
+   * \brief Sample the binding cache size, BU rate and BU to BA service
+   * time of every HA and LMA installed from now on.
+   *
+   * \returns the sampler, shared by copies of this helper
+   */
+  Ptr<Mip6dBindingSampler> EnableBindingSampler (void);
+  /**
+   * \returns the binding sampler, 0 if not enabled
+   */
+  Ptr<Mip6dBindingSampler> GetBindingSampler (void) const;
+
+  /**
+   * \brief Monitor the inner flows of every node installed from now on:
+   * MNs and CNs as endpoints, HAs, LMAs and MRs as tunnel ends.
+   *
+   * Install () the CNs and MNNs on the returned monitor too.
+   *
+   * \returns the monitor, shared by copies of this helper
+   */
+  Ptr<Mip6FlowMonitor> EnableFlowMonitor (void);
+  /**
+   * \returns the flow monitor, 0 if not enabled
+   */
+  Ptr<Mip6FlowMonitor> GetFlowMonitor (void) const;
+
+  /**
+   * \param node a node configured through this helper, or not at all
+   * \returns the role mip6d runs with on the node, ROLE_MN by default
+   */
+  enum Role GetRole (Ptr<Node> node);
+
 private:
   /**
    * \internal
    */
-  ApplicationContainer InstallPriv (Ptr<Node> node);
+  ApplicationContainer InstallPriv (Ptr<Node> node, bool generate = true);
   void GenerateConfig (Ptr<Node> node);
+  void GenerateConfigs (NodeContainer c);
+  void StoreConfig (Ptr<Node> node, const std::string &rendered);
+  void ShareConfig (Ptr<Node> node, const std::string &rendered);
+
+  std::string m_spoolDir;
+  // absolute path of m_spoolDir, once created
+  std::string m_spoolPath;
+  enum ConfigSharing m_sharing;
+  // rendered content -> path of the shared copy inside the spool
+  std::map<std::string, std::string> m_sharedConfigs;
+  uint32_t m_renderedConfigs;
+  uint32_t m_renderThreads;
+  bool m_deferredConfig;
+  Time m_deferredLead;
+  Ptr<Mip6dStartPolicy> m_startPolicy;
+  uint32_t m_stackSize[ROLE_COUNT];
+  Ptr<Mip6dConvergenceMonitor> m_convergence;
+  bool m_handoverTracing;
+  Ptr<Mip6dBindingSampler> m_bindingSampler;
+  Ptr<Mip6FlowMonitor> m_flowMonitor;
 };
 
 } // namespace ns3
@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6d-log-ring.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <set>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6dLogRing");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6dLogRing);
+
+// One thread drains the FIFOs of every ring. It holds s_lock while it
+// touches a ring, and Remove () takes s_lock too, so a ring is never
+// drained once it is stopped.
+class Mip6dLogReader
+{
+public:
+  ~Mip6dLogReader ();
+  static void Add (Mip6dLogRing *ring);
+  static void Remove (Mip6dLogRing *ring);
+
+private:
+  static void Run (void);
+
+  static std::mutex s_lock;
+  static std::set<Mip6dLogRing *> s_rings;
+  static std::thread s_thread;
+  static std::atomic<bool> s_stop;
+};
+
+std::mutex Mip6dLogReader::s_lock;
+std::set<Mip6dLogRing *> Mip6dLogReader::s_rings;
+std::thread Mip6dLogReader::s_thread;
+std::atomic<bool> Mip6dLogReader::s_stop (false);
+// destroyed before s_thread: stops a reader left running at exit, when
+// the rings were never disposed
+static Mip6dLogReader g_reader;
+
+Mip6dLogReader::~Mip6dLogReader ()
+{
+  if (s_thread.joinable ())
+    {
+      s_stop = true;
+      s_thread.join ();
+    }
+}
+
+void
+Mip6dLogReader::Add (Mip6dLogRing *ring)
+{
+  std::lock_guard<std::mutex> guard (s_lock);
+  s_rings.insert (ring);
+  if (!s_thread.joinable ())
+    {
+      s_stop = false;
+      s_thread = std::thread (&Mip6dLogReader::Run);
+    }
+}
+
+void
+Mip6dLogReader::Remove (Mip6dLogRing *ring)
+{
+  {
+    std::lock_guard<std::mutex> guard (s_lock);
+    s_rings.erase (ring);
+    if (!s_rings.empty () || !s_thread.joinable ())
+      {
+        return;
+      }
+    s_stop = true;
+  }
+  s_thread.join ();
+}
+
+void
+Mip6dLogReader::Run (void)
+{
+  std::vector<struct pollfd> fds;
+  std::vector<Mip6dLogRing *> rings;
+  while (!s_stop)
+    {
+      // rings come and go: rebuild the set at each round
+      fds.clear ();
+      rings.clear ();
+      {
+        std::lock_guard<std::mutex> guard (s_lock);
+        for (std::set<Mip6dLogRing *>::iterator i = s_rings.begin (); i != s_rings.end (); ++i)
+          {
+            struct pollfd fd;
+            fd.fd = (*i)->m_readFd;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            fds.push_back (fd);
+            rings.push_back (*i);
+          }
+      }
+      if (::poll (fds.empty () ? 0 : &fds[0], fds.size (), 100) <= 0)
+        {
+          continue;
+        }
+      std::lock_guard<std::mutex> guard (s_lock);
+      for (uint32_t i = 0; i < fds.size (); i++)
+        {
+          if ((fds[i].revents & POLLIN) && s_rings.find (rings[i]) != s_rings.end ())
+            {
+              std::lock_guard<std::mutex> ringGuard (rings[i]->m_lock);
+              rings[i]->Drain ();
+            }
+        }
+    }
+}
+
+TypeId
+Mip6dLogRing::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dLogRing")
+    .SetParent<Object> ()
+    .AddConstructor<Mip6dLogRing> ()
+  ;
+  return tid;
+}
+
+Mip6dLogRing::Mip6dLogRing ()
+  : m_readFd (-1),
+    m_writeFd (-1),
+    m_head (0),
+    m_written (0)
+{
+}
+
+Mip6dLogRing::~Mip6dLogRing ()
+{
+  Stop ();
+}
+
+void
+Mip6dLogRing::DoDispose (void)
+{
+  Stop ();
+  Object::DoDispose ();
+}
+
+void
+Mip6dLogRing::Start (std::string fifo, uint32_t capacity)
+{
+  NS_ABORT_MSG_IF (m_readFd >= 0, "log ring of " << m_fifo << " already started");
+  NS_ABORT_MSG_IF (capacity == 0, "empty log ring");
+  if (::mkfifo (fifo.c_str (), S_IRUSR | S_IWUSR) != 0 && errno != EEXIST)
+    {
+      NS_FATAL_ERROR ("cannot create " << fifo << ": " << std::strerror (errno));
+    }
+  m_fifo = fifo;
+  m_buffer.resize (capacity);
+  m_readFd = ::open (fifo.c_str (), O_RDONLY | O_NONBLOCK);
+  NS_ABORT_MSG_IF (m_readFd < 0, "cannot read " << fifo << ": " << std::strerror (errno));
+  m_writeFd = ::open (fifo.c_str (), O_WRONLY | O_NONBLOCK);
+  NS_ABORT_MSG_IF (m_writeFd < 0, "cannot open " << fifo << ": " << std::strerror (errno));
+  NS_LOG_DEBUG ("keeping the last " << capacity << " bytes of " << fifo);
+  Mip6dLogReader::Add (this);
+}
+
+void
+Mip6dLogRing::Stop (void)
+{
+  if (m_readFd < 0)
+    {
+      return;
+    }
+  Mip6dLogReader::Remove (this);
+  ::close (m_readFd);
+  ::close (m_writeFd);
+  ::unlink (m_fifo.c_str ());
+  m_readFd = -1;
+  m_writeFd = -1;
+}
+
+void
+Mip6dLogRing::Drain (void)
+{
+  char chunk[4096];
+  ssize_t n;
+  uint32_t capacity = m_buffer.size ();
+  while ((n = ::read (m_readFd, chunk, sizeof (chunk))) > 0)
+    {
+      m_written += n;
+      const char *data = chunk;
+      if ((uint32_t)n >= capacity)
+        {
+          data += n - capacity;
+          n = capacity;
+        }
+      uint32_t first = std::min<uint32_t> (n, capacity - m_head);
+      std::memcpy (&m_buffer[m_head], data, first);
+      std::memcpy (&m_buffer[0], data + first, n - first);
+      m_head = (m_head + n) % capacity;
+    }
+}
+
+void
+Mip6dLogRing::Dump (std::ostream &os)
+{
+  std::lock_guard<std::mutex> guard (m_lock);
+  if (m_readFd >= 0)
+    {
+      Drain ();
+    }
+  uint32_t capacity = m_buffer.size ();
+  if (m_written <= capacity)
+    {
+      os.write (m_buffer.empty () ? "" : &m_buffer[0], m_written);
+      return;
+    }
+  os << "[" << m_written - capacity << " bytes dropped]" << std::endl;
+  os.write (&m_buffer[m_head], capacity - m_head);
+  os.write (&m_buffer[0], m_head);
+}
+
+uint64_t
+Mip6dLogRing::GetNWritten (void)
+{
+  std::lock_guard<std::mutex> guard (m_lock);
+  if (m_readFd >= 0)
+    {
+      Drain ();
+    }
+  return m_written;
+}
+
+} // namespace ns3
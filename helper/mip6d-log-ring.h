@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6D_LOG_RING_H
+#define MIP6D_LOG_RING_H
+
+#include "ns3/object.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace ns3 {
+
+/**
+ * \brief keep the last bytes of the debug log of a mip6d daemon in memory
+ *
+ * The daemon is given a FIFO as DebugLogFile. A single reader thread,
+ * shared by every ring of the simulation, drains all the FIFOs into
+ * their bounded buffers, so the log never reaches the disk and costs no
+ * simulation time: only the last Capacity bytes are kept, to be dumped
+ * on request, e.g. when a test fails.
+ *
+ * Mip6dHelper::EnableLogRing () aggregates one to each node.
+ */
+class Mip6dLogRing : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6dLogRing ();
+  virtual ~Mip6dLogRing ();
+
+  /**
+   * \brief Create the FIFO and start draining it
+   * \param fifo host path of the FIFO, created if needed
+   * \param capacity bytes kept
+   */
+  void Start (std::string fifo, uint32_t capacity);
+
+  /**
+   * \brief Write the kept bytes, oldest first, after draining what the
+   * daemon wrote since the last read
+   * \param os output stream
+   */
+  void Dump (std::ostream &os);
+  /**
+   * \returns the number of bytes the daemon has written so far
+   */
+  uint64_t GetNWritten (void);
+
+private:
+  friend class Mip6dLogReader;
+  virtual void DoDispose (void);
+  // drain the FIFO; called with m_lock held
+  void Drain (void);
+  void Stop (void);
+
+  std::string m_fifo;
+  int m_readFd;
+  // kept open so that the FIFO never sees its last writer go, which
+  // would make it readable (EOF) forever
+  int m_writeFd;
+  std::mutex m_lock;
+  std::vector<char> m_buffer;
+  uint32_t m_head;
+  uint64_t m_written;
+};
+
+} // namespace ns3
+
+#endif /* MIP6D_LOG_RING_H */
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2026 Hajime Tazaki, NICT
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mip6d-start-policy.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Mip6dStartPolicy");
+
+NS_OBJECT_ENSURE_REGISTERED (Mip6dStartPolicy);
+NS_OBJECT_ENSURE_REGISTERED (Mip6dLinearStartPolicy);
+NS_OBJECT_ENSURE_REGISTERED (Mip6dBatchStartPolicy);
+NS_OBJECT_ENSURE_REGISTERED (Mip6dJitterStartPolicy);
+NS_OBJECT_ENSURE_REGISTERED (Mip6dAllAtOnceStartPolicy);
+
+TypeId
+Mip6dStartPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dStartPolicy")
+    .SetParent<Object> ()
+  ;
+  return tid;
+}
+
+Mip6dStartPolicy::Mip6dStartPolicy ()
+  : m_last (Seconds (0)),
+    m_count (0)
+{
+}
+
+Time
+Mip6dStartPolicy::GetStartTime (Ptr<Node> node)
+{
+  Time start = DoGetStartTime (node);
+  NS_LOG_DEBUG ("node " << node->GetId () << " starts mip6d at " << start);
+  if (start > m_last)
+    {
+      m_last = start;
+    }
+  m_count++;
+  return start;
+}
+
+Time
+Mip6dStartPolicy::GetLastStartTime (void) const
+{
+  return m_last;
+}
+
+uint32_t
+Mip6dStartPolicy::GetNStarted (void) const
+{
+  return m_count;
+}
+
+TypeId
+Mip6dLinearStartPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dLinearStartPolicy")
+    .SetParent<Mip6dStartPolicy> ()
+    .AddConstructor<Mip6dLinearStartPolicy> ()
+    .AddAttribute ("Start", "Start time of node 0.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dLinearStartPolicy::m_start),
+                   MakeTimeChecker ())
+    .AddAttribute ("Interval", "Delay added per node id.",
+                   TimeValue (Seconds (0.01)),
+                   MakeTimeAccessor (&Mip6dLinearStartPolicy::m_interval),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+Time
+Mip6dLinearStartPolicy::DoGetStartTime (Ptr<Node> node)
+{
+  return m_start + m_interval * node->GetId ();
+}
+
+TypeId
+Mip6dBatchStartPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dBatchStartPolicy")
+    .SetParent<Mip6dStartPolicy> ()
+    .AddConstructor<Mip6dBatchStartPolicy> ()
+    .AddAttribute ("Start", "Start time of the first wave.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dBatchStartPolicy::m_start),
+                   MakeTimeChecker ())
+    .AddAttribute ("WaveInterval", "Delay between two waves.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dBatchStartPolicy::m_waveInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("BatchSize", "Number of daemons started per wave.",
+                   UintegerValue (100),
+                   MakeUintegerAccessor (&Mip6dBatchStartPolicy::m_batchSize),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+Mip6dBatchStartPolicy::Mip6dBatchStartPolicy ()
+  : m_installed (0)
+{
+}
+
+Time
+Mip6dBatchStartPolicy::DoGetStartTime (Ptr<Node> node)
+{
+  uint32_t wave = m_installed++ / m_batchSize;
+  return m_start + m_waveInterval * wave;
+}
+
+TypeId
+Mip6dJitterStartPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dJitterStartPolicy")
+    .SetParent<Mip6dStartPolicy> ()
+    .AddConstructor<Mip6dJitterStartPolicy> ()
+    .AddAttribute ("Start", "Earliest start time.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dJitterStartPolicy::m_start),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxJitter", "Upper bound of the random delay added to Start.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dJitterStartPolicy::m_maxJitter),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+Mip6dJitterStartPolicy::Mip6dJitterStartPolicy ()
+{
+  m_jitter = CreateObject<UniformRandomVariable> ();
+}
+
+int64_t
+Mip6dJitterStartPolicy::AssignStreams (int64_t stream)
+{
+  m_jitter->SetStream (stream);
+  return 1;
+}
+
+Time
+Mip6dJitterStartPolicy::DoGetStartTime (Ptr<Node> node)
+{
+  return m_start + Seconds (m_jitter->GetValue (0, m_maxJitter.GetSeconds ()));
+}
+
+TypeId
+Mip6dAllAtOnceStartPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Mip6dAllAtOnceStartPolicy")
+    .SetParent<Mip6dStartPolicy> ()
+    .AddConstructor<Mip6dAllAtOnceStartPolicy> ()
+    .AddAttribute ("Start", "Start time of every daemon.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Mip6dAllAtOnceStartPolicy::m_start),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+Time
+Mip6dAllAtOnceStartPolicy::DoGetStartTime (Ptr<Node> node)
+{
+  return m_start;
+}
+
+} // namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2026 Hajime Tazaki, NICT
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MIP6D_START_POLICY_H
+#define MIP6D_START_POLICY_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \brief decide when each mip6d daemon installed by Mip6dHelper starts
+ *
+ * Mip6dHelper asks the policy for a start time once per installed node.
+ * The policy remembers the latest time it handed out, i.e. how long it
+ * takes until every daemon has started.
+ */
+class Mip6dStartPolicy : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  Mip6dStartPolicy ();
+
+  /**
+   * \param node the node mip6d is being installed on
+   * \returns the start time of its mip6d application
+   */
+  Time GetStartTime (Ptr<Node> node);
+  /**
+   * \returns the latest start time handed out so far
+   */
+  Time GetLastStartTime (void) const;
+  /**
+   * \returns the number of start times handed out so far
+   */
+  uint32_t GetNStarted (void) const;
+
+private:
+  virtual Time DoGetStartTime (Ptr<Node> node) = 0;
+
+  Time m_last;
+  uint32_t m_count;
+};
+
+/**
+ * \brief start at Start + Interval * node id (the historical behaviour)
+ */
+class Mip6dLinearStartPolicy : public Mip6dStartPolicy
+{
+public:
+  static TypeId GetTypeId (void);
+private:
+  virtual Time DoGetStartTime (Ptr<Node> node);
+
+  Time m_start;
+  Time m_interval;
+};
+
+/**
+ * \brief start daemons in waves of BatchSize, WaveInterval apart,
+ *        in installation order
+ */
+class Mip6dBatchStartPolicy : public Mip6dStartPolicy
+{
+public:
+  static TypeId GetTypeId (void);
+  Mip6dBatchStartPolicy ();
+private:
+  virtual Time DoGetStartTime (Ptr<Node> node);
+
+  Time m_start;
+  Time m_waveInterval;
+  uint32_t m_batchSize;
+  uint32_t m_installed;
+};
+
+/**
+ * \brief start at Start plus a uniform random jitter in [0, MaxJitter)
+ */
+class Mip6dJitterStartPolicy : public Mip6dStartPolicy
+{
+public:
+  static TypeId GetTypeId (void);
+  Mip6dJitterStartPolicy ();
+  /**
+   * \param stream first stream index to use
+   * \returns the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+private:
+  virtual Time DoGetStartTime (Ptr<Node> node);
+
+  Time m_start;
+  Time m_maxJitter;
+  Ptr<UniformRandomVariable> m_jitter;
+};
+
+/**
+ * \brief start every daemon at Start
+ */
+class Mip6dAllAtOnceStartPolicy : public Mip6dStartPolicy
+{
+public:
+  static TypeId GetTypeId (void);
+private:
+  virtual Time DoGetStartTime (Ptr<Node> node);
+
+  Time m_start;
+};
+
+} // namespace ns3
+
+#endif /* MIP6D_START_POLICY_H */
@@ -0,0 +1,420 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mobility-topology-helper.h"
+#include "ns3/quagga-helper.h"
+#include "ns3/csma-helper.h"
+#include "ns3/wifi-helper.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <sstream>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MobilityTopologyHelper");
+
+// host parts on the home link, kept apart so that counts never collide
+static const uint64_t HOST_HA = 1;
+static const uint64_t HOST_AR = 1ULL << 16;
+static const uint64_t HOST_HOME_ADDRESS = 1ULL << 32;
+// host parts on the access, correspondent and mobile network links
+static const uint64_t HOST_ROUTER = 1;
+static const uint64_t HOST_CN = 2;
+
+MobilityTopologyHelper::MobilityTopologyHelper ()
+  : m_base ("2001:1:2::"),
+    m_nHa (1),
+    m_nAr (2),
+    m_layout (LAYOUT_LINE),
+    m_spacing (100.0),
+    m_columns (0),
+    m_nMn (1),
+    m_nMr (0),
+    m_nMnnPerMr (0),
+    m_nCn (1)
+{
+}
+
+void
+MobilityTopologyHelper::SetBasePrefix (Ipv6Address base)
+{
+  m_base = base;
+}
+
+void
+MobilityTopologyHelper::SetHomeAgents (uint32_t n)
+{
+  NS_ASSERT_MSG (n > 0, "at least one home agent is needed");
+  m_nHa = n;
+}
+
+void
+MobilityTopologyHelper::SetAccessRouters (uint32_t n, enum Layout layout,
+                                          double spacing, uint32_t columns)
+{
+  NS_ASSERT_MSG (n > 0, "at least one access router is needed");
+  m_nAr = n;
+  m_layout = layout;
+  m_spacing = spacing;
+  m_columns = columns;
+}
+
+void
+MobilityTopologyHelper::SetMobileNodes (uint32_t n)
+{
+  m_nMn = n;
+}
+
+void
+MobilityTopologyHelper::SetMobileRouters (uint32_t n, uint32_t nodesPerRouter)
+{
+  m_nMr = n;
+  m_nMnnPerMr = nodesPerRouter;
+}
+
+void
+MobilityTopologyHelper::SetCorrespondentNodes (uint32_t n)
+{
+  m_nCn = n;
+}
+
+void
+MobilityTopologyHelper::Create (void)
+{
+  // home link, access links, correspondent link, mobile networks
+  NS_ABORT_MSG_IF (2 + m_nAr + m_nMr > 0x10000, "too many links for a /48");
+
+  // creation order gives each node its devices in sim<N> order
+  m_ha.Create (m_nHa);
+  m_ar.Create (m_nAr);
+  m_mn.Create (m_nMn);
+  m_mr.Create (m_nMr);
+  m_cn.Create (m_nCn);
+
+  CsmaHelper csma;
+  csma.Install (NodeContainer (m_ha, m_ar));
+
+  WifiHelper wifi;
+  YansWifiPhyHelper phy;
+  YansWifiChannelHelper phyChannel = YansWifiChannelHelper::Default ();
+  WifiMacHelper mac;
+  phy.SetChannel (phyChannel.Create ());
+  mac.SetType ("ns3::AdhocWifiMac");
+  wifi.SetStandard (WIFI_STANDARD_80211a);
+  wifi.Install (phy, mac, NodeContainer (m_ar, m_mn, m_mr));
+
+  if (m_nCn > 0)
+    {
+      csma.Install (NodeContainer (NodeContainer (m_ar.Get (0)), m_cn));
+    }
+  for (uint32_t i = 0; i < m_nMr; i++)
+    {
+      NodeContainer mnn;
+      mnn.Create (m_nMnnPerMr);
+      m_mnn.Add (mnn);
+      csma.Install (NodeContainer (NodeContainer (m_mr.Get (i)), mnn));
+    }
+
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < m_nAr; i++)
+    {
+      positions->Add (GetAccessRouterPosition (i));
+    }
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (positions);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (m_ar);
+}
+
+KernelConfigHelper
+MobilityTopologyHelper::GetKernelConfig (void) const
+{
+  KernelConfigHelper kernel;
+  NodeContainer all = GetNodes ();
+  kernel.SetLinkUp (all, "lo");
+
+  for (uint32_t i = 0; i < m_nHa; i++)
+    {
+      kernel.AddAddress (m_ha.Get (i), "sim0", Format (GetHomeAgentAddress (i), 64));
+      kernel.SetLinkUp (m_ha.Get (i), "sim0");
+    }
+
+  std::string defaultHa = Format (GetHomeAgentAddress (0), 0);
+  for (uint32_t i = 0; i < m_nAr; i++)
+    {
+      Ptr<Node> ar = m_ar.Get (i);
+      kernel.AddAddress (ar, "sim0", Format (GetAddress (0, HOST_AR + i), 64));
+      kernel.AddAddress (ar, "sim1", Format (GetAddress (1 + i, HOST_ROUTER), 64));
+      kernel.SetLinkUp (ar, "sim0");
+      kernel.SetLinkUp (ar, "sim1");
+      if (i == 0 && m_nCn > 0)
+        {
+          kernel.AddAddress (ar, "sim2", Format (GetAddress (1 + m_nAr, HOST_ROUTER), 64));
+          kernel.SetLinkUp (ar, "sim2");
+        }
+      // everything else, mobile networks included, is behind a home agent
+      kernel.AddRoute (ar, Format (m_base, 48) + " via " + defaultHa + " dev sim0");
+    }
+  kernel.AddSysctl (m_ar, ".net.ipv6.conf.all.forwarding", "1");
+
+  kernel.SetLinkUp (m_mn, "sim0");
+  for (uint32_t i = 0; i < m_nMr; i++)
+    {
+      Ptr<Node> mr = m_mr.Get (i);
+      kernel.SetLinkUp (mr, "sim0");
+      kernel.AddAddress (mr, "sim1", Format (GetAddress (2 + m_nAr + i, HOST_ROUTER), 64));
+      kernel.SetLinkUp (mr, "sim1");
+    }
+  kernel.SetLinkUp (m_mnn, "sim0");
+
+  for (uint32_t i = 0; i < m_nCn; i++)
+    {
+      kernel.AddAddress (m_cn.Get (i), "sim0", Format (GetCorrespondentAddress (i), 64));
+      kernel.SetLinkUp (m_cn.Get (i), "sim0");
+      kernel.AddRoute (m_cn.Get (i), "default via "
+                       + Format (GetAddress (1 + m_nAr, HOST_ROUTER), 0));
+    }
+  return kernel;
+}
+
+KernelConfigHelper
+MobilityTopologyHelper::GetTunnelConfig (void) const
+{
+  KernelConfigHelper kernel;
+  kernel.SetLinkUp (m_ha, "ip6tnl0");
+  kernel.SetLinkUp (m_mn, "ip6tnl0");
+  kernel.SetLinkUp (m_mr, "ip6tnl0");
+
+  // as in the examples, the home agents get their routes once mip6d runs
+  for (uint32_t i = 0; i < m_nHa; i++)
+    {
+      Ptr<Node> ha = m_ha.Get (i);
+      for (uint32_t j = 0; j < m_nAr; j++)
+        {
+          kernel.AddRoute (ha, Format (GetAccessPrefix (j), 64) + " via "
+                           + Format (GetAddress (0, HOST_AR + j), 0) + " dev sim0");
+        }
+      if (m_nCn > 0)
+        {
+          kernel.AddRoute (ha, Format (GetAddress (1 + m_nAr, 0), 64) + " via "
+                           + Format (GetAddress (0, HOST_AR), 0) + " dev sim0");
+        }
+      // mobile networks served by the other home agents
+      for (uint32_t j = 0; j < m_nMr; j++)
+        {
+          uint32_t servedBy = GetServingHomeAgent (m_nMn + j);
+          if (servedBy != i)
+            {
+              kernel.AddRoute (ha, Format (GetMobileNetworkPrefix (j), 64) + " via "
+                               + Format (GetHomeAgentAddress (servedBy), 0) + " dev sim0");
+            }
+        }
+    }
+  return kernel;
+}
+
+NodeContainer
+MobilityTopologyHelper::ConfigureRadvd (QuaggaHelper &quagga) const
+{
+  // the home prefix, with the home agent flag, on the home link
+  std::string home = Format (GetHomePrefix (), 64);
+  quagga.EnableRadvd (m_ar.Get (0), "sim0", home.c_str ());
+  quagga.EnableHomeAgentFlag (m_ar.Get (0), "sim0");
+  for (uint32_t i = 0; i < m_nAr; i++)
+    {
+      std::string access = Format (GetAccessPrefix (i), 64);
+      quagga.EnableRadvd (m_ar.Get (i), "sim1", access.c_str ());
+    }
+  if (m_nCn > 0)
+    {
+      std::string correspondent = Format (GetAddress (1 + m_nAr, 0), 64);
+      quagga.EnableRadvd (m_ar.Get (0), "sim2", correspondent.c_str ());
+    }
+  for (uint32_t i = 0; i < m_nMr; i++)
+    {
+      std::string network = Format (GetMobileNetworkPrefix (i), 64);
+      quagga.EnableRadvd (m_mr.Get (i), "sim1", network.c_str ());
+    }
+  return NodeContainer (m_ar, m_mr);
+}
+
+NodeContainer
+MobilityTopologyHelper::ConfigureMip6d (Mip6dHelper &mip6d) const
+{
+  if (m_nMr > 0)
+    {
+      for (uint32_t i = 0; i < m_nHa; i++)
+        {
+          mip6d.AddHaServedPrefix (m_ha.Get (i), m_base, Ipv6Prefix (48));
+        }
+    }
+  mip6d.EnableHA (m_ha);
+
+  NodeContainer mobiles (m_mn, m_mr);
+  for (uint32_t i = 0; i < mobiles.GetN (); i++)
+    {
+      Ptr<Node> node = mobiles.Get (i);
+      mip6d.AddHomeAgentAddress (node, GetHomeAgentAddress (GetServingHomeAgent (i)));
+      mip6d.AddHomeAddress (node, GetHomeAddress (i), Ipv6Prefix (64));
+      mip6d.AddEgressInterface (node, "sim0");
+    }
+  for (uint32_t i = 0; i < m_nMr; i++)
+    {
+      mip6d.AddMobileNetworkPrefix (m_mr.Get (i), GetAddress (2 + m_nAr + i, HOST_ROUTER),
+                                    Ipv6Prefix (64));
+    }
+  if (m_nMr > 0)
+    {
+      mip6d.EnableMR (m_mr);
+    }
+  return NodeContainer (m_ha, mobiles);
+}
+
+NodeContainer
+MobilityTopologyHelper::GetHomeAgents (void) const
+{
+  return m_ha;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetAccessRouters (void) const
+{
+  return m_ar;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetMobileNodes (void) const
+{
+  return m_mn;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetMobileRouters (void) const
+{
+  return m_mr;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetMobileNetworkNodes (void) const
+{
+  return m_mnn;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetCorrespondentNodes (void) const
+{
+  return m_cn;
+}
+
+NodeContainer
+MobilityTopologyHelper::GetNodes (void) const
+{
+  NodeContainer all (m_ha, m_ar, m_mn);
+  all.Add (m_mr);
+  all.Add (m_cn);
+  all.Add (m_mnn);
+  return all;
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetHomePrefix (void) const
+{
+  return GetAddress (0, 0);
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetHomeAgentAddress (uint32_t i) const
+{
+  return GetAddress (0, HOST_HA + i);
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetAccessPrefix (uint32_t i) const
+{
+  return GetAddress (1 + i, 0);
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetHomeAddress (uint32_t i) const
+{
+  return GetAddress (0, HOST_HOME_ADDRESS + i);
+}
+
+uint32_t
+MobilityTopologyHelper::GetServingHomeAgent (uint32_t i) const
+{
+  return i % m_nHa;
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetMobileNetworkPrefix (uint32_t i) const
+{
+  return GetAddress (2 + m_nAr + i, 0);
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetCorrespondentAddress (uint32_t i) const
+{
+  return GetAddress (1 + m_nAr, HOST_CN + i);
+}
+
+Vector
+MobilityTopologyHelper::GetAccessRouterPosition (uint32_t i) const
+{
+  if (m_layout == LAYOUT_LINE)
+    {
+      return Vector (i * m_spacing, 0, 0);
+    }
+  uint32_t columns = m_columns;
+  if (columns == 0)
+    {
+      columns = std::ceil (std::sqrt (m_nAr));
+    }
+  return Vector ((i % columns) * m_spacing, (i / columns) * m_spacing, 0);
+}
+
+Ipv6Address
+MobilityTopologyHelper::GetAddress (uint32_t subnet, uint64_t host) const
+{
+  uint8_t bytes[16];
+  m_base.GetBytes (bytes);
+  bytes[6] = subnet >> 8;
+  bytes[7] = subnet;
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      bytes[15 - i] = host >> (8 * i);
+    }
+  return Ipv6Address (bytes);
+}
+
+std::string
+MobilityTopologyHelper::Format (Ipv6Address address, uint32_t plen)
+{
+  std::ostringstream os;
+  os << address;
+  if (plen)
+    {
+      os << "/" << plen;
+    }
+  return os.str ();
+}
+
+} // namespace ns3
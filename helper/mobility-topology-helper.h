@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MOBILITY_TOPOLOGY_HELPER_H
+#define MOBILITY_TOPOLOGY_HELPER_H
+
+#include "ns3/node-container.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/vector.h"
+#include "kernel-config-helper.h"
+#include "mip6d-helper.h"
+#include <string>
+
+namespace ns3 {
+
+class QuaggaHelper;
+
+/**
+ * \brief build HA/AR/MN/MR scenarios of any size with a computed address
+ * plan
+ *
+ * The topology generalizes the one of the examples:
+ *
+ * \verbatim
+ *         HA ... HA
+ *          |sim0  |sim0            home link <base>:0::/64
+ *   -------+------+------+----------+----------
+ *                        |sim0      |sim0
+ *                       AR 0 ...   AR i ---sim2--- CN ... CN  (AR 0 only)
+ *                        |sim1      |sim1          <base>:<nAR+1>::/64
+ *                      ::::::::  shared wifi  ::::::::
+ *            access links <base>:<i+1>::/64
+ *                 |sim0                |sim0
+ *                 MN                   MR ---sim1--- MNN ... MNN
+ *                                      mobile network <base>:<nAR+2+j>::/64
+ * \endverbatim
+ *
+ * All /64 are carved out of a /48 base prefix. Home agents and access
+ * routers are numbered on the home link, mobile nodes and routers get
+ * their home addresses there, and serve round-robin across the home
+ * agents. Access routers are placed on a line or a grid; the mobile
+ * nodes and routers need a mobility model installed by the caller.
+ *
+ * Create () builds the nodes and devices; the Get*Config () and
+ * Configure* () methods then queue the addresses, routes, radvd and
+ * mip6d configuration, to be installed directly or as SetupSequencer
+ * steps.
+ */
+class MobilityTopologyHelper
+{
+public:
+  enum Layout
+  {
+    LAYOUT_LINE, /**< access routers on the x axis */
+    LAYOUT_GRID  /**< access routers on a grid, row by row */
+  };
+
+  MobilityTopologyHelper ();
+
+  /**
+   * \param base a /48 prefix, 2001:1:2:: by default
+   */
+  void SetBasePrefix (Ipv6Address base);
+  void SetHomeAgents (uint32_t n);
+  /**
+   * \param n number of access routers
+   * \param layout how to place them
+   * \param spacing distance between two neighbouring routers, in meters
+   * \param columns routers per row of a grid, 0 for a square grid
+   */
+  void SetAccessRouters (uint32_t n, enum Layout layout = LAYOUT_LINE,
+                         double spacing = 100.0, uint32_t columns = 0);
+  void SetMobileNodes (uint32_t n);
+  /**
+   * \param n number of mobile routers
+   * \param nodesPerRouter number of mobile network nodes behind each
+   */
+  void SetMobileRouters (uint32_t n, uint32_t nodesPerRouter);
+  /**
+   * \param n number of correspondent nodes, behind access router 0
+   */
+  void SetCorrespondentNodes (uint32_t n);
+
+  /**
+   * \brief Create the nodes and their devices, and place the access
+   * routers
+   */
+  void Create (void);
+
+  /**
+   * \returns the addresses, links, routes and sysctls of every node
+   */
+  KernelConfigHelper GetKernelConfig (void) const;
+  /**
+   * \returns the commands bringing the mip6d tunnel devices up, to be
+   * applied once the daemons have created them
+   */
+  KernelConfigHelper GetTunnelConfig (void) const;
+  /**
+   * \brief Enable radvd on the access links, the home link and the
+   * mobile networks
+   * \param quagga the helper to configure
+   * \returns the nodes to install quagga on
+   */
+  NodeContainer ConfigureRadvd (QuaggaHelper &quagga) const;
+  /**
+   * \brief Enable the home agents, mobile nodes and mobile routers
+   * \param mip6d the helper to configure
+   * \returns the nodes to install mip6d on
+   */
+  NodeContainer ConfigureMip6d (Mip6dHelper &mip6d) const;
+
+  NodeContainer GetHomeAgents (void) const;
+  NodeContainer GetAccessRouters (void) const;
+  NodeContainer GetMobileNodes (void) const;
+  NodeContainer GetMobileRouters (void) const;
+  NodeContainer GetMobileNetworkNodes (void) const;
+  NodeContainer GetCorrespondentNodes (void) const;
+  /**
+   * \returns every node of the topology
+   */
+  NodeContainer GetNodes (void) const;
+
+  Ipv6Address GetHomePrefix (void) const;
+  Ipv6Address GetHomeAgentAddress (uint32_t i) const;
+  Ipv6Address GetAccessPrefix (uint32_t i) const;
+  /**
+   * \param i index of a mobile node, then of a mobile router
+   */
+  Ipv6Address GetHomeAddress (uint32_t i) const;
+  /**
+   * \param i index of a mobile node, then of a mobile router
+   * \returns the index of the home agent the mobile registers with; the
+   * other home agents route a mobile router's network through it
+   */
+  uint32_t GetServingHomeAgent (uint32_t i) const;
+  Ipv6Address GetMobileNetworkPrefix (uint32_t i) const;
+  Ipv6Address GetCorrespondentAddress (uint32_t i) const;
+  Vector GetAccessRouterPosition (uint32_t i) const;
+
+private:
+  Ipv6Address GetAddress (uint32_t subnet, uint64_t host) const;
+  static std::string Format (Ipv6Address address, uint32_t plen);
+
+  Ipv6Address m_base;
+  uint32_t m_nHa;
+  uint32_t m_nAr;
+  enum Layout m_layout;
+  double m_spacing;
+  uint32_t m_columns;
+  uint32_t m_nMn;
+  uint32_t m_nMr;
+  uint32_t m_nMnnPerMr;
+  uint32_t m_nCn;
+
+  NodeContainer m_ha;
+  NodeContainer m_ar;
+  NodeContainer m_mn;
+  NodeContainer m_mr;
+  NodeContainer m_mnn;
+  NodeContainer m_cn;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TOPOLOGY_HELPER_H */
@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mobility-traffic-probe.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MobilityTrafficProbe");
+
+NS_OBJECT_ENSURE_REGISTERED (MobilityTrafficProbe);
+
+enum
+{
+  // an IPv4 header with options, a UDP header and what Mip6PacketParser
+  // reads of the inner IPv6 packet
+  PEEK_BYTES = 320
+};
+
+MobilityTrafficCounters::MobilityTrafficCounters ()
+  : rxPackets (0),
+    rxBytes (0),
+    txPackets (0),
+    txBytes (0)
+{
+}
+
+TypeId
+MobilityTrafficProbe::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MobilityTrafficProbe")
+    .SetParent<Object> ()
+    .AddConstructor<MobilityTrafficProbe> ()
+    .AddAttribute ("Dsmip6Port", "UDP port of DSMIP6 encapsulation (RFC 5555).",
+                   UintegerValue (4191),
+                   MakeUintegerAccessor (&MobilityTrafficProbe::m_dsmip6Port),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddTraceSource ("Packet", "A watched node sent or received a packet: the device, "
+                     "the packet, its class, what the parser found and whether it was sent.",
+                     MakeTraceSourceAccessor (&MobilityTrafficProbe::m_packetTrace),
+                     "ns3::MobilityTrafficProbe::PacketCallback")
+  ;
+  return tid;
+}
+
+MobilityTrafficProbe::MobilityTrafficProbe ()
+  : m_dsmip6Port (4191)
+{
+}
+
+void
+MobilityTrafficProbe::DoDispose (void)
+{
+  m_counters.clear ();
+  Object::DoDispose ();
+}
+
+void
+MobilityTrafficProbe::Watch (Ptr<Node> node)
+{
+  if (m_counters.find (node->GetId ()) != m_counters.end ())
+    {
+      return;
+    }
+  m_counters[node->GetId ()].resize (CLASS_COUNT);
+  Mip6PacketTap::Install (node, MakeCallback (&MobilityTrafficProbe::Tap,
+                                              Ptr<MobilityTrafficProbe> (this)),
+                          true, true, true);
+}
+
+void
+MobilityTrafficProbe::Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  uint8_t version = 0;
+  packet->CopyData (&version, 1);
+  Mip6PacketInfo info;
+  enum Class c;
+  if ((version >> 4) == 4)
+    {
+      uint8_t buffer[PEEK_BYTES];
+      uint32_t size = packet->CopyData (buffer, sizeof (buffer));
+      c = Mip6PacketParser::ParseIpv4 (buffer, size, m_dsmip6Port, info)
+        ? CLASS_DSMIP6 : CLASS_NATIVE;
+    }
+  else
+    {
+      Mip6PacketParser::Parse (packet, info);
+      c = info.hasMobilityHeader ? CLASS_SIGNALING
+        : info.tunneled ? CLASS_TUNNELED : CLASS_NATIVE;
+    }
+
+  MobilityTrafficCounters &counters = m_counters[device->GetNode ()->GetId ()][c];
+  if (sent)
+    {
+      counters.txPackets++;
+      counters.txBytes += packet->GetSize ();
+    }
+  else
+    {
+      counters.rxPackets++;
+      counters.rxBytes += packet->GetSize ();
+    }
+  m_packetTrace (device, packet, c, info, sent);
+}
+
+MobilityTrafficCounters
+MobilityTrafficProbe::GetCounters (enum Class c) const
+{
+  MobilityTrafficCounters total;
+  for (std::map<uint32_t, std::vector<MobilityTrafficCounters> >::const_iterator i = m_counters.begin ();
+       i != m_counters.end (); ++i)
+    {
+      total.rxPackets += i->second[c].rxPackets;
+      total.rxBytes += i->second[c].rxBytes;
+      total.txPackets += i->second[c].txPackets;
+      total.txBytes += i->second[c].txBytes;
+    }
+  return total;
+}
+
+MobilityTrafficCounters
+MobilityTrafficProbe::GetCounters (Ptr<Node> node, enum Class c) const
+{
+  std::map<uint32_t, std::vector<MobilityTrafficCounters> >::const_iterator i =
+    m_counters.find (node->GetId ());
+  if (i == m_counters.end ())
+    {
+      return MobilityTrafficCounters ();
+    }
+  return i->second[c];
+}
+
+std::string
+MobilityTrafficProbe::GetClassName (enum Class c)
+{
+  switch (c)
+    {
+    case CLASS_NATIVE:
+      return "native";
+    case CLASS_TUNNELED:
+      return "tunneled";
+    case CLASS_SIGNALING:
+      return "signaling";
+    case CLASS_DSMIP6:
+      return "dsmip6";
+    default:
+      return "unknown";
+    }
+}
+
+void
+MobilityTrafficProbe::Print (std::ostream &os) const
+{
+  os << "node,class,rx_packets,rx_bytes,tx_packets,tx_bytes" << std::endl;
+  for (std::map<uint32_t, std::vector<MobilityTrafficCounters> >::const_iterator i = m_counters.begin ();
+       i != m_counters.end (); ++i)
+    {
+      for (uint32_t c = 0; c < CLASS_COUNT; c++)
+        {
+          const MobilityTrafficCounters &counters = i->second[c];
+          os << i->first << "," << GetClassName (static_cast<enum Class> (c)) << ","
+             << counters.rxPackets << "," << counters.rxBytes << ","
+             << counters.txPackets << "," << counters.txBytes << std::endl;
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef MOBILITY_TRAFFIC_PROBE_H
+#define MOBILITY_TRAFFIC_PROBE_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/traced-callback.h"
+#include "mip6-packet-parser.h"
+#include <map>
+#include <vector>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \brief packets and bytes of one traffic class, in each direction
+ */
+struct MobilityTrafficCounters
+{
+  MobilityTrafficCounters ();
+
+  uint64_t rxPackets;
+  uint64_t rxBytes;
+  uint64_t txPackets;
+  uint64_t txBytes;
+};
+
+/**
+ * \brief count the traffic of mobile nodes by how it is carried
+ *
+ * The probe taps the packets the watched nodes send and receive and sorts
+ * them into:
+ *  - native: plain IPv6 (or IPv4) packets, Neighbor Discovery included
+ *  - tunneled: IPv6-in-IPv6, i.e. the MN/MR to HA bidirectional tunnel
+ *  - signaling: packets carrying a Mobility Header
+ *  - DSMIP6: IPv6 carried over IPv4, directly or in UDP (RFC 5555)
+ *
+ * Packets are only peeked at: the first bytes are read by
+ * Mip6PacketParser, nothing is copied or deserialized into ns-3 headers,
+ * so the probe keeps up with high-rate traffic through the tunnel. The
+ * Packet trace hands the parsed fields (of the inner IPv6 packet for
+ * DSMIP6) to users which need more than counters, e.g. to spot echo
+ * replies.
+ */
+class MobilityTrafficProbe : public Object
+{
+public:
+  enum Class
+  {
+    CLASS_NATIVE,
+    CLASS_TUNNELED,
+    CLASS_SIGNALING,
+    CLASS_DSMIP6,
+    CLASS_COUNT
+  };
+
+  static TypeId GetTypeId (void);
+
+  MobilityTrafficProbe ();
+
+  /**
+   * \brief Count the packets a node sends and receives
+   * \param node the node, typically a MN, MR or MNN
+   */
+  void Watch (Ptr<Node> node);
+
+  /**
+   * \returns the counters of a class over every watched node
+   */
+  MobilityTrafficCounters GetCounters (enum Class c) const;
+  /**
+   * \returns the counters of a class for one watched node
+   */
+  MobilityTrafficCounters GetCounters (Ptr<Node> node, enum Class c) const;
+  /**
+   * \brief Print the counters of every watched node, one line per class
+   */
+  void Print (std::ostream &os) const;
+
+  static std::string GetClassName (enum Class c);
+
+private:
+  virtual void DoDispose (void);
+  void Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+
+  uint16_t m_dsmip6Port;
+  // node id to counters indexed by class
+  std::map<uint32_t, std::vector<MobilityTrafficCounters> > m_counters;
+  TracedCallback<Ptr<NetDevice>, Ptr<const Packet>, uint8_t, const Mip6PacketInfo &, bool> m_packetTrace;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TRAFFIC_PROBE_H */
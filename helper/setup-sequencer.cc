@@ -0,0 +1,314 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "setup-sequencer.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/names.h"
+#include "ns3/dce-application.h"
+#include "ns3/linux-socket-fd-factory.h"
+#include "mip6d-handover-tracer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SetupSequencer");
+
+NS_OBJECT_ENSURE_REGISTERED (SetupSequencer);
+
+TypeId
+SetupSequencer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SetupSequencer")
+    .SetParent<Object> ()
+    .AddConstructor<SetupSequencer> ()
+    .AddAttribute ("PollInterval", "Interval between two checks of a readiness condition.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&SetupSequencer::m_pollInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Timeout", "How long a step may take before the simulation is "
+                   "stopped with what it still waits for; 0 waits forever.",
+                   TimeValue (Seconds (100)),
+                   MakeTimeAccessor (&SetupSequencer::m_timeout),
+                   MakeTimeChecker ())
+    .AddTraceSource ("StepDone", "A step is done: its name and how long it took.",
+                     MakeTraceSourceAccessor (&SetupSequencer::m_stepDone),
+                     "ns3::SetupSequencer::StepDoneCallback")
+  ;
+  return tid;
+}
+
+SetupSequencer::SetupSequencer ()
+{
+}
+
+void
+SetupSequencer::DoDispose (void)
+{
+  m_steps.clear ();
+  Object::DoDispose ();
+}
+
+uint32_t
+SetupSequencer::AddStep (std::string name, Launcher launch, bool waitForExit)
+{
+  Step step;
+  step.name = name;
+  step.launch = launch;
+  step.waitForExit = waitForExit;
+  step.pendingPredecessors = 0;
+  step.pendingConditions = 0;
+  step.pendingProcesses = 0;
+  step.failedProcesses = 0;
+  step.doneTime = Seconds (-1);
+  m_steps.push_back (step);
+  return m_steps.size () - 1;
+}
+
+static ApplicationContainer
+LaunchKernel (KernelConfigHelper kernel)
+{
+  return kernel.Install (Seconds (0));
+}
+
+uint32_t
+SetupSequencer::AddKernelStep (std::string name, KernelConfigHelper kernel)
+{
+  return AddStep (name, MakeBoundCallback (&LaunchKernel, kernel));
+}
+
+static bool
+BindingUpdateSent (Ptr<Mip6dHandoverTracer> tracer)
+{
+  return tracer->GetFirstBuSent () >= Seconds (0);
+}
+
+static bool
+Registered (Ptr<Mip6dHandoverTracer> tracer)
+{
+  return tracer->GetFirstRegistration () >= Seconds (0);
+}
+
+static ApplicationContainer
+LaunchMip6d (Mip6dHelper mip6d, NodeContainer nodes)
+{
+  return mip6d.Install (nodes);
+}
+
+uint32_t
+SetupSequencer::AddMip6dStep (std::string name, Mip6dHelper mip6d, NodeContainer nodes)
+{
+  uint32_t step = AddStep (name, MakeBoundCallback (&LaunchMip6d, mip6d, nodes), false);
+  // The kernel creates ip6tnl0 by itself: the first Binding Update is
+  // what shows that mip6d is up and has a care-of address.
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      enum Mip6dHelper::Role role = mip6d.GetRole (nodes.Get (i));
+      if (role == Mip6dHelper::ROLE_MN || role == Mip6dHelper::ROLE_MR)
+        {
+          AddCondition (step, nodes.Get (i),
+                        MakeBoundCallback (&BindingUpdateSent,
+                                           Mip6dHandoverTracer::Install (nodes.Get (i))));
+        }
+    }
+  return step;
+}
+
+void
+SetupSequencer::AddCondition (uint32_t step, Ptr<Node> node, Condition ready)
+{
+  NS_ABORT_MSG_IF (step >= m_steps.size (), "No step " << step);
+  Readiness condition;
+  condition.node = node;
+  condition.ready = ready;
+  condition.met = false;
+  m_steps[step].conditions.push_back (condition);
+}
+
+bool
+SetupSequencer::InterfaceExists (Ptr<Node> node, std::string ifname)
+{
+  Ptr<LinuxSocketFdFactory> kern = node->GetObject<LinuxSocketFdFactory> ();
+  return !kern->Get (".net.ipv6.conf." + ifname + ".mtu").empty ();
+}
+
+void
+SetupSequencer::AddInterfaceCondition (uint32_t step, Ptr<Node> node, std::string ifname)
+{
+  AddCondition (step, node, MakeBoundCallback (&SetupSequencer::InterfaceExists, node, ifname));
+}
+
+void
+SetupSequencer::AddRegistrationCondition (uint32_t step, Ptr<Node> node)
+{
+  AddCondition (step, node, MakeBoundCallback (&Registered, Mip6dHandoverTracer::Install (node)));
+}
+
+void
+SetupSequencer::After (uint32_t step, uint32_t predecessor)
+{
+  NS_ABORT_MSG_IF (step >= m_steps.size () || predecessor >= m_steps.size (),
+                   "No step " << step << " or " << predecessor);
+  m_steps[predecessor].successors.push_back (step);
+  m_steps[step].pendingPredecessors++;
+}
+
+void
+SetupSequencer::Start (Time at)
+{
+  for (uint32_t i = 0; i < m_steps.size (); i++)
+    {
+      if (m_steps[i].pendingPredecessors == 0)
+        {
+          Simulator::Schedule (at, &SetupSequencer::StartStep, this, i);
+        }
+    }
+}
+
+bool
+SetupSequencer::IsDone (uint32_t step) const
+{
+  return m_steps[step].doneTime >= Seconds (0);
+}
+
+Time
+SetupSequencer::GetDoneTime (uint32_t step) const
+{
+  return m_steps[step].doneTime;
+}
+
+uint32_t
+SetupSequencer::GetNFailed (uint32_t step) const
+{
+  return m_steps[step].failedProcesses;
+}
+
+void
+SetupSequencer::StartStep (uint32_t id)
+{
+  Step &step = m_steps[id];
+  NS_LOG_INFO ("starting step " << step.name);
+  step.startTime = Simulator::Now ();
+
+  if (!step.launch.IsNull ())
+    {
+      ApplicationContainer apps = step.launch ();
+      for (uint32_t i = 0; step.waitForExit && i < apps.GetN (); i++)
+        {
+          Ptr<DceApplication> process = DynamicCast<DceApplication> (apps.Get (i));
+          if (process)
+            {
+              process->SetFinishedCallback (MakeBoundCallback (&SetupSequencer::ProcessExited,
+                                                               Ptr<SetupSequencer> (this), id));
+              step.pendingProcesses++;
+            }
+        }
+    }
+
+  if (m_timeout > Seconds (0))
+    {
+      step.timeoutEvent = Simulator::Schedule (m_timeout, &SetupSequencer::TimedOut, this, id);
+    }
+  step.pendingConditions = step.conditions.size ();
+  for (uint32_t i = 0; i < step.conditions.size (); i++)
+    {
+      Simulator::ScheduleWithContext (step.conditions[i].node->GetId (), Seconds (0),
+                                      &SetupSequencer::Poll, this, id, i);
+    }
+  CheckDone (id);
+}
+
+void
+SetupSequencer::ProcessExited (Ptr<SetupSequencer> sequencer, uint32_t id,
+                               uint16_t pid, int status)
+{
+  Step &step = sequencer->m_steps[id];
+  NS_LOG_DEBUG ("step " << step.name << ": pid " << pid << " exited with " << status);
+  if (status != 0)
+    {
+      NS_LOG_WARN ("step " << step.name << ": pid " << pid << " failed with status " << status);
+      step.failedProcesses++;
+    }
+  step.pendingProcesses--;
+  sequencer->CheckDone (id);
+}
+
+void
+SetupSequencer::Poll (uint32_t id, uint32_t index)
+{
+  Step &step = m_steps[id];
+  if (!step.conditions[index].ready ())
+    {
+      Simulator::Schedule (m_pollInterval, &SetupSequencer::Poll, this, id, index);
+      return;
+    }
+  step.conditions[index].met = true;
+  step.pendingConditions--;
+  CheckDone (id);
+}
+
+void
+SetupSequencer::CheckDone (uint32_t id)
+{
+  Step &step = m_steps[id];
+  if (step.pendingProcesses > 0 || step.pendingConditions > 0)
+    {
+      return;
+    }
+  step.timeoutEvent.Cancel ();
+  step.doneTime = Simulator::Now ();
+  NS_LOG_INFO ("step " << step.name << " done after "
+               << (step.doneTime - step.startTime).GetSeconds () << "s, "
+               << step.failedProcesses << " process(es) failed");
+  m_stepDone (step.name, step.doneTime - step.startTime);
+
+  for (uint32_t i = 0; i < step.successors.size (); i++)
+    {
+      Step &next = m_steps[step.successors[i]];
+      if (--next.pendingPredecessors == 0)
+        {
+          StartStep (step.successors[i]);
+        }
+    }
+}
+
+void
+SetupSequencer::TimedOut (uint32_t id)
+{
+  const Step &step = m_steps[id];
+  std::ostringstream pending;
+  for (uint32_t i = 0; i < step.conditions.size (); i++)
+    {
+      if (step.conditions[i].met)
+        {
+          continue;
+        }
+      Ptr<Node> node = step.conditions[i].node;
+      std::string name = Names::FindName (node);
+      pending << " condition " << i << " on node " << node->GetId ()
+              << (name.empty () ? "" : " (" + name + ")") << ";";
+    }
+  if (step.pendingProcesses > 0)
+    {
+      pending << " " << step.pendingProcesses << " process(es) still running;";
+    }
+  NS_FATAL_ERROR ("step " << step.name << " not done after " << m_timeout.GetSeconds ()
+                  << "s:" << pending.str ());
+}
+
+} // namespace ns3
@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef SETUP_SEQUENCER_H
+#define SETUP_SEQUENCER_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/callback.h"
+#include "ns3/traced-callback.h"
+#include "ns3/application-container.h"
+#include "ns3/node-container.h"
+#include "kernel-config-helper.h"
+#include "mip6d-helper.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief bring a scenario up step by step, each step starting as soon as
+ * the steps it depends on are done, instead of at hardcoded times
+ *
+ * A step launches applications when it starts. It is done when the
+ * processes it launched have exited (unless it was told not to wait for
+ * them, e.g. for daemons) and all its readiness conditions hold.
+ * Conditions are polled every PollInterval in the context of their node,
+ * so that they can query the node's kernel. A step not done Timeout after
+ * it started stops the simulation with the pending conditions and
+ * processes; a process exiting with a non-zero status is logged and
+ * counted (GetNFailed ()), but does not keep its step from being done.
+ */
+class SetupSequencer : public Object
+{
+public:
+  typedef Callback<ApplicationContainer> Launcher;
+  typedef Callback<bool> Condition;
+
+  static TypeId GetTypeId (void);
+
+  SetupSequencer ();
+
+  /**
+   * \brief Add a step running arbitrary applications
+   * \param name name of the step, for logs and the StepDone trace
+   * \param launch installs and returns the applications of the step; they
+   * must start at time 0, i.e. when the step starts. May be null.
+   * \param waitForExit whether the step is done only once its DCE
+   * processes have exited
+   * \returns the step id
+   */
+  uint32_t AddStep (std::string name, Launcher launch, bool waitForExit = true);
+
+  /**
+   * \brief Add a step applying the settings queued in a KernelConfigHelper
+   * \param name name of the step
+   * \param kernel the queued settings, copied
+   * \returns the step id, done once the ip processes have exited
+   */
+  uint32_t AddKernelStep (std::string name, KernelConfigHelper kernel);
+
+  /**
+   * \brief Add a step starting mip6d on nodes
+   * \param name name of the step
+   * \param mip6d the configured helper, copied. Its start policy should
+   * start daemons at time 0.
+   * \param nodes the nodes to install mip6d on
+   * \returns the step id, done once mip6d has sent a Binding Update from
+   * every MN and MR of \p nodes. HA, LMA, MAG and CN daemons give no
+   * sign of being up before the mobile nodes register; they only start
+   * with the step. A mobile node starting at home sends no Binding
+   * Update: leave it out of \p nodes and install it in a step without
+   * conditions, or the step times out.
+   */
+  uint32_t AddMip6dStep (std::string name, Mip6dHelper mip6d, NodeContainer nodes);
+
+  /**
+   * \brief Add a readiness condition to a step
+   * \param step the step id
+   * \param node the node in whose context the condition is evaluated
+   * \param ready returns true once the condition holds
+   */
+  void AddCondition (uint32_t step, Ptr<Node> node, Condition ready);
+
+  /**
+   * \brief Make a step wait until a network interface exists on a node
+   * \param step the step id
+   * \param node the node
+   * \param ifname interface name, e.g. "ip6tnl0"
+   */
+  void AddInterfaceCondition (uint32_t step, Ptr<Node> node, std::string ifname);
+
+  /**
+   * \brief Make a step wait until a MN or MR has registered with its home
+   * agent, i.e. received an accepting Binding Acknowledgement
+   * \param step the step id
+   * \param node the mobile node or router
+   */
+  void AddRegistrationCondition (uint32_t step, Ptr<Node> node);
+
+  /**
+   * \brief Make a step start only once another one is done
+   * \param step the step id
+   * \param predecessor the id of the step to wait for
+   */
+  void After (uint32_t step, uint32_t predecessor);
+
+  /**
+   * \brief Start the steps without predecessors
+   * \param at when to start
+   */
+  void Start (Time at);
+
+  /**
+   * \param step the step id
+   * \returns whether the step is done
+   */
+  bool IsDone (uint32_t step) const;
+
+  /**
+   * \param step the step id
+   * \returns when the step was done, or a negative time if it is not
+   */
+  Time GetDoneTime (uint32_t step) const;
+
+  /**
+   * \param step the step id
+   * \returns how many processes of the step exited with a non-zero status
+   */
+  uint32_t GetNFailed (uint32_t step) const;
+
+  /**
+   * \param node the node, must be the current context
+   * \param ifname interface name
+   * \returns whether the interface exists in the node's kernel
+   */
+  static bool InterfaceExists (Ptr<Node> node, std::string ifname);
+
+private:
+  virtual void DoDispose (void);
+
+  struct Readiness
+  {
+    Ptr<Node> node;
+    Condition ready;
+    bool met;
+  };
+  struct Step
+  {
+    std::string name;
+    Launcher launch;
+    bool waitForExit;
+    std::vector<uint32_t> successors;
+    uint32_t pendingPredecessors;
+    std::vector<Readiness> conditions;
+    uint32_t pendingConditions;
+    uint32_t pendingProcesses;
+    uint32_t failedProcesses;
+    Time startTime;
+    Time doneTime;
+    EventId timeoutEvent;
+  };
+
+  void StartStep (uint32_t step);
+  void Poll (uint32_t step, uint32_t condition);
+  void CheckDone (uint32_t step);
+  void TimedOut (uint32_t step);
+  static void ProcessExited (Ptr<SetupSequencer> sequencer, uint32_t step,
+                             uint16_t pid, int status);
+
+  std::vector<Step> m_steps;
+  Time m_pollInterval;
+  Time m_timeout;
+  TracedCallback<std::string, Time> m_stepDone;
+};
+
+} // namespace ns3
+
+#endif /* SETUP_SEQUENCER_H */
@@ -52,8 +52,23 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-helper.h"
 #include "ns3/mip6d-helper.h"
+#include "ns3/mobility-traffic-probe.h"
+#include "ns3/mip6-packet-parser.h"
+#include "ns3/mip6-binding-update-generator.h"
+#include "ns3/mip6-goodput.h"
+#include "ns3/kernel-config-helper.h"
+#include "ns3/mobility-topology-helper.h"
 #include "ns3/ping6-helper.h"
 #include "ns3/ethernet-header.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <limits.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #define OUTPUT(x)                                                       \
   {                                                                     \
@@ -75,99 +90,163 @@ extern "C" void dce_umip_test_store_test_error (const char *s)
 using namespace ns3;
 namespace ns3 {
 
-static void RunIp (Ptr<Node> node, Time at, std::string str)
+// Make the relative entries of a colon-separated search path absolute,
+// so that it survives a chdir.
+static void
+AbsolutizeSearchPath (const char *name, std::string base)
 {
-  DceApplicationHelper process;
-  ApplicationContainer apps;
-  process.SetBinary ("ip");
-  process.SetStackSize (1 << 16);
-  process.ResetArguments ();
-  process.ParseArguments (str.c_str ());
-  apps = process.Install (node);
-  apps.Start (at);
+  const char *value = ::getenv (name);
+  if (value == 0)
+    {
+      return;
+    }
+  std::istringstream in (value);
+  std::string entry, result;
+  while (std::getline (in, entry, ':'))
+    {
+      if (!entry.empty () && entry[0] != '/')
+        {
+          entry = base + "/" + entry;
+        }
+      result += (result.empty () ? "" : ":") + entry;
+    }
+  ::setenv (name, result.c_str (), 1);
+}
+
+static int
+RemoveEntry (const char *path, const struct stat *sb, int flag, struct FTW *ftw)
+{
+  return ::remove (path);
 }
 
-static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *address)
+// rm -rf without a shell
+static void
+RemoveTree (std::string path)
 {
-  std::ostringstream oss;
-  oss << "-f inet6 addr add " << address << " dev " << name;
-  RunIp (node, at, oss.str ());
+  ::nftw (path.c_str (), &RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// Create a directory of our own and make it the working directory, so that
+// a case never shares files-N, pid files or mip6d spools. The working
+// directory is process-wide: cases of the suite run one after the other.
+// \returns the directory; cwd is set to the previous working directory
+static std::string
+EnterPrivateDirectory (std::string name, std::string &cwd)
+{
+  char buf[PATH_MAX];
+  NS_ABORT_MSG_IF (::getcwd (buf, sizeof (buf)) == 0, "getcwd failed");
+  cwd = buf;
+  std::string dirTemplate = cwd + "/dce-umip-" + name + "-XXXXXX";
+  std::vector<char> dir (dirTemplate.begin (), dirTemplate.end ());
+  dir.push_back ('\0');
+  NS_ABORT_MSG_IF (::mkdtemp (&dir[0]) == 0, "cannot create " << dirTemplate);
+  AbsolutizeSearchPath ("DCE_PATH", cwd);
+  AbsolutizeSearchPath ("DCE_ROOT", cwd);
+  NS_ABORT_MSG_IF (::chdir (&dir[0]) != 0, "cannot enter " << &dir[0]);
+  return &dir[0];
+}
+
+// \returns the number of entries of a directory, -1 if it does not exist
+static int
+CountEntries (std::string path)
+{
+  DIR *dir = ::opendir (path.c_str ());
+  if (dir == 0)
+    {
+      return -1;
+    }
+  int count = 0;
+  struct dirent *ent;
+  while ((ent = ::readdir (dir)) != 0)
+    {
+      count += std::string (ent->d_name) != "." && std::string (ent->d_name) != "..";
+    }
+  ::closedir (dir);
+  return count;
+}
+
+static bool
+FileExists (std::string path)
+{
+  struct stat st;
+  return ::stat (path.c_str (), &st) == 0;
+}
+
+// \returns the content of a file, empty if it can not be read
+static std::string
+ReadFile (std::string path)
+{
+  std::ifstream in (path.c_str ());
+  std::ostringstream content;
+  content << in.rdbuf ();
+  return content.str ();
 }
 
 class DceUmipTestCase : public TestCase
 {
 public:
-  DceUmipTestCase (std::string testname, Time maxDuration);
-  void WifiRxCallback (std::string context, Ptr<const Packet> packet);
+  DceUmipTestCase (std::string testname, Time maxDuration, Time grace);
 private:
   virtual void DoRun (void);
   static void Finished (int *pstatus, uint16_t pid, int status);
+  void Converged (Time at);
+  void StartPing (void);
+  void ProbePacket (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                    uint8_t trafficClass, const Mip6PacketInfo &info, bool sent);
 
   std::string m_testname;
   Time m_maxDuration;
+  // how long to keep running after the first echo reply
+  Time m_grace;
   bool m_pingStatus;
+  Time m_firstReply;
+  Time m_lastReply;
   bool m_debug;
+  Ptr<Node> m_pingNode;
+  bool m_pingStarted;
+  // private root of the files-N directories of this case
+  std::string m_rootDir;
 };
 
 void
-DceUmipTestCase::WifiRxCallback (std::string context, Ptr<const Packet> originalPacket)
+DceUmipTestCase::ProbePacket (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                              uint8_t trafficClass, const Mip6PacketInfo &info, bool sent)
 {
-  if (m_pingStatus)
+  if (sent || (m_pingStatus && m_grace.IsZero ()))
     {
       return;
     }
-  Ptr<Packet> packet = originalPacket->Copy ();
-
-  LlcSnapHeader llc;
-  packet->RemoveHeader (llc);
-
-  Ipv4Header v4hdr;
-  Icmpv4Header icmphdr;
-  Ipv6Header v6hdr;
-  Icmpv6Header icmp6hdr;
-
-#if 0
-  if (packet->PeekHeader (v4hdr) != 0)
-    {
-      packet->RemoveHeader (v4hdr);
-      packet->RemoveHeader (icmphdr);
-      if (icmphdr.GetType () == Icmpv4Header::ECHO_REPLY)
-        {
-          m_pingStatus = true;
-        }
-    }
-  else 
-#endif
-    if (packet->PeekHeader (v6hdr) != 0)
+  // the parser looks through one level of IPv6-in-IPv6
+  if (info.protocol == 58 && info.icmpType == Icmpv6Header::ICMPV6_ECHO_REPLY)
     {
-      packet->RemoveHeader (v6hdr);
-      // if the next header is ipv6, it's ip6-in-ip6
-      if (v6hdr.GetNextHeader () == Ipv6Header::IPV6_IPV6)
-        {
-          Ipv6Header v6hdr_2;
-          packet->RemoveHeader (v6hdr_2);
-        }
-      packet->RemoveHeader (icmp6hdr);
-      if (icmp6hdr.GetType () == Icmpv6Header::ICMPV6_ECHO_REPLY)
+      if (!m_pingStatus)
         {
+          // passed: no need to wait for m_maxDuration
           m_pingStatus = true;
+          m_firstReply = Simulator::Now ();
+          Simulator::Stop (m_grace);
         }
+      m_lastReply = Simulator::Now ();
     }
 
   if (m_debug)
     {
-      std::cout << context << " " << packet << std::endl;
+      std::cout << "node " << device->GetNode ()->GetId () << " "
+                << MobilityTrafficProbe::GetClassName (static_cast<MobilityTrafficProbe::Class> (trafficClass))
+                << " " << packet << std::endl;
       packet->Print (std::cout);
       std::cout << std::endl;
     }
 }
 
-DceUmipTestCase::DceUmipTestCase (std::string testname, Time maxDuration)
+DceUmipTestCase::DceUmipTestCase (std::string testname, Time maxDuration, Time grace)
   : TestCase (testname),
     m_testname (testname),
     m_maxDuration (maxDuration),
+    m_grace (grace),
     m_pingStatus (false),
-    m_debug (false)
+    m_debug (false),
+    m_pingStarted (false)
 {
 }
 void
@@ -176,8 +255,42 @@ DceUmipTestCase::Finished (int *pstatus, uint16_t pid, int status)
   *pstatus = status;
 }
 void
+DceUmipTestCase::Converged (Time at)
+{
+  if (m_debug)
+    {
+      OUTPUT ("all mobile nodes registered at " << at.GetSeconds () << "s");
+    }
+  StartPing ();
+}
+void
+DceUmipTestCase::StartPing (void)
+{
+  if (m_pingStarted)
+    {
+      return;
+    }
+  m_pingStarted = true;
+
+  DceApplicationHelper dce;
+  ApplicationContainer apps;
+
+  dce.SetBinary ("ping6");
+  dce.SetStackSize (1 << 16);
+  dce.ResetArguments ();
+  dce.ResetEnvironment ();
+  // dce.AddArgument ("-i");
+  // dce.AddArgument (interPacketInterval.GetSeconds ());
+  dce.AddArgument ("2001:1:2:6::7");
+  apps = dce.Install (m_pingNode);
+  apps.Start (Seconds (0));
+}
+void
 DceUmipTestCase::DoRun (void)
 {
+  std::string cwd;
+  m_rootDir = EnterPrivateDirectory (m_testname, cwd);
+
   //
   //  Step 1
   //  Node Basic Configuration
@@ -268,62 +381,71 @@ DceUmipTestCase::DoRun (void)
   // Prefix configuration
   std::string ha_sim0 ("2001:1:2:3::1/64");
 
+  // Initial bring-up: one ip batch process per node
+  KernelConfigHelper kernel;
+
   // For HA
-  AddAddress (ha.Get (0), Seconds (0.1), "sim0", ha_sim0.c_str ());
-  RunIp (ha.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ha.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ha.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  RunIp (ha.Get (0), Seconds (3.1), "addr list");
-  //  RunIp (ha.Get (0), Seconds (3.2), "-6 route add default via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
-  RunIp (ha.Get (0), Seconds (3.15), "-6 route add 2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  kernel.AddAddress (ha.Get (0), "sim0", ha_sim0);
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
 
   // For AR1 (the intermediate node)
-  AddAddress (ar.Get (0), Seconds (0.1), "sim0", "2001:1:2:3::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim1", "2001:1:2:4::2/64");
-  AddAddress (ar.Get (0), Seconds (0.1), "sim2", "2001:1:2:6::2/64");
-  RunIp (ar.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (0), Seconds (0.13), "link set sim1 up");
-  RunIp (ar.Get (0), Seconds (0.14), "link set sim2 up");
-  RunIp (ar.Get (0), Seconds (0.15), "-6 route add 2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
-  RunIp (ar.Get (0), Seconds (0.15), "route show table all");
-  Ptr<LinuxSocketFdFactory> kern = ar.Get (0)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (0)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (0), "sim0", "2001:1:2:3::2/64");
+  kernel.AddAddress (ar.Get (0), "sim1", "2001:1:2:4::2/64");
+  kernel.AddAddress (ar.Get (0), "sim2", "2001:1:2:6::2/64");
+  kernel.SetLinkUp (ar.Get (0), "lo");
+  kernel.SetLinkUp (ar.Get (0), "sim0");
+  kernel.SetLinkUp (ar.Get (0), "sim1");
+  kernel.SetLinkUp (ar.Get (0), "sim2");
+  kernel.AddRoute (ar.Get (0), "2001:1:2::/48 via 2001:1:2:3::1 dev sim0");
+  kernel.AddIpCommand (ar.Get (0), "route show table all");
 
   // For AR2 (the intermediate node)
-  AddAddress (ar.Get (1), Seconds (0.1), "sim0", "2001:1:2:3::3/64");
-  AddAddress (ar.Get (1), Seconds (0.1), "sim1", "2001:1:2:7::2/64");
-  RunIp (ar.Get (1), Seconds (0.11), "link set lo up");
-  RunIp (ar.Get (1), Seconds (0.11), "link set sim0 up");
-  RunIp (ar.Get (1), Seconds (0.13), "link set sim1 up");
-  RunIp (ar.Get (1), Seconds (0.15), "-6 route add 2001:1:2:5::1/64 via 2001:1:2:3::1 dev sim0");
-  //  RunIp (ar.Get (1), Seconds (0.15), "route show table all");
-  kern = ar.Get (1)->GetObject<LinuxSocketFdFactory>();
-  Simulator::ScheduleWithContext (ar.Get (1)->GetId (), Seconds (0.1),
-                                  MakeEvent (&LinuxSocketFdFactory::Set, kern,
-                                             ".net.ipv6.conf.all.forwarding", "1"));
+  kernel.AddAddress (ar.Get (1), "sim0", "2001:1:2:3::3/64");
+  kernel.AddAddress (ar.Get (1), "sim1", "2001:1:2:7::2/64");
+  kernel.SetLinkUp (ar.Get (1), "lo");
+  kernel.SetLinkUp (ar.Get (1), "sim0");
+  kernel.SetLinkUp (ar.Get (1), "sim1");
+  kernel.AddRoute (ar.Get (1), "2001:1:2:5::1/64 via 2001:1:2:3::1 dev sim0");
+  //  kernel.AddIpCommand (ar.Get (1), "route show table all");
+
+  // IPv6 forwarding on both ARs
+  kernel.AddSysctl (ar, ".net.ipv6.conf.all.forwarding", "1");
 
   // For MR
-  RunIp (mr.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (mr.Get (0), Seconds (5.11), "link set sim0 up");
-  RunIp (mr.Get (0), Seconds (3.0), "link set ip6tnl0 up");
-  AddAddress (mr.Get (0), Seconds (0.12), "sim1", "2001:1:2:5::1/64");
-  RunIp (mr.Get (0), Seconds (0.13), "link set sim1 up");
+  kernel.SetLinkUp (mr.Get (0), "lo");
+  kernel.AddAddress (mr.Get (0), "sim1", "2001:1:2:5::1/64");
+  kernel.SetLinkUp (mr.Get (0), "sim1");
 
   // For MNN
-  RunIp (mnn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (mnn.Get (0), Seconds (0.11), "link set sim0 up");
-  RunIp (mnn.Get (0), Seconds (10.13), "addr list");
+  kernel.SetLinkUp (mnn.Get (0), "lo");
+  kernel.SetLinkUp (mnn.Get (0), "sim0");
 
   // For CN
-  RunIp (cn.Get (0), Seconds (0.11), "link set lo up");
-  RunIp (cn.Get (0), Seconds (1.11), "link set sim0 up");
-  RunIp (cn.Get (0), Seconds (1.11), "add default via 2001:1:2:6::2");
-  AddAddress (cn.Get (0), Seconds (0.12), "sim0", "2001:1:2:6::7/64");
+  kernel.SetLinkUp (cn.Get (0), "lo");
+  kernel.AddAddress (cn.Get (0), "sim0", "2001:1:2:6::7/64");
+  kernel.Install (Seconds (0.1));
+
+  kernel.SetLinkUp (cn.Get (0), "sim0");
+  kernel.AddIpCommand (cn.Get (0), "add default via 2001:1:2:6::2");
+  kernel.Install (Seconds (1.11));
+
+  // Once mip6d has created the tunnel devices
+  kernel.SetLinkUp (ha.Get (0), "ip6tnl0");
+  kernel.AddIpCommand (ha.Get (0), "addr list");
+  //  kernel.AddRoute (ha.Get (0), "default via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:4::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:6::/64 via 2001:1:2:3::2 dev sim0");
+  kernel.AddRoute (ha.Get (0), "2001:1:2:7::/64 via 2001:1:2:3::3 dev sim0");
+  kernel.SetLinkUp (mr.Get (0), "ip6tnl0");
+  kernel.Install (Seconds (3.0));
+
+  // MR attaches to the visited network
+  kernel.SetLinkUp (mr.Get (0), "sim0");
+  kernel.Install (Seconds (5.11));
+
+  kernel.AddIpCommand (mnn.Get (0), "addr list");
+  kernel.Install (Seconds (10.13));
 
   if (m_debug)
     {
@@ -345,10 +467,14 @@ DceUmipTestCase::DoRun (void)
     {
       mip6d.AddHaServedPrefix (ha.Get (0), Ipv6Address ("2001:1:2::"), Ipv6Prefix (48));
     }
+  // mip6d logs stay in memory, and are only printed if the case fails
+  mip6d.EnableLogRing (NodeContainer (ha, mr));
   mip6d.EnableHA (ha);
+  Ptr<Mip6dBindingSampler> sampler = mip6d.EnableBindingSampler ();
   mip6d.Install (ha);
 
   // MR
+  Ptr<Mip6dConvergenceMonitor> convergence = mip6d.EnableConvergenceMonitor ();
   mip6d.AddMobileNetworkPrefix (mr.Get (0), Ipv6Address ("2001:1:2:5::1"), Ipv6Prefix (64));
   std::string ha_addr = ha_sim0;
   ha_addr.replace (ha_addr.find ("/"), 3, "\0  ");
@@ -380,36 +506,16 @@ DceUmipTestCase::DoRun (void)
   // Set up ping application
   //
   // MNN
-  // Ping6
-  /* Install IPv4/IPv6 stack */
-  DceApplicationHelper dce;
-
-  uint32_t packetSize = 1024;
-  uint32_t maxPacketCount = 50000000;
-  Time interPacketInterval = Seconds (1.);
-
-  dce.SetBinary ("ping6");
-  dce.SetStackSize (1 << 16);
-  dce.ResetArguments ();
-  dce.ResetEnvironment ();
-  // dce.AddArgument ("-i");
-  // dce.AddArgument (interPacketInterval.GetSeconds ());
-  dce.AddArgument ("2001:1:2:6::7");
-  if (m_testname == "MIP6")
-    {
-      apps = dce.Install (mr.Get (0));
-      // Configure Validity Check Parser
-      Config::Connect ("/NodeList/3/DeviceList/0/$ns3::WifiNetDevice/Mac/MacRx",
-                       MakeCallback (&DceUmipTestCase::WifiRxCallback, this));
-    }
-  else if (m_testname == "NEMO")
-    {
-      apps = dce.Install (mnn.Get (0));
-      // Configure Validity Check Parser
-      Config::Connect ("/NodeList/5/DeviceList/0/$ns3::WifiNetDevice/Mac/MacRx",
-                       MakeCallback (&DceUmipTestCase::WifiRxCallback, this));
-    }
-  apps.Start (Seconds (50.0));
+  // Ping6, started as soon as the bindings are in place
+  m_pingNode = m_testname == "NEMO" ? mnn.Get (0) : mr.Get (0);
+  // Validity check: echo replies reaching the pinging node
+  Ptr<MobilityTrafficProbe> probe = CreateObject<MobilityTrafficProbe> ();
+  probe->Watch (m_pingNode);
+  probe->TraceConnectWithoutContext ("Packet", MakeCallback (&DceUmipTestCase::ProbePacket, this));
+  convergence->TraceConnectWithoutContext ("Converged",
+                                           MakeCallback (&DceUmipTestCase::Converged, this));
+  // in case no Binding Acknowledgement is seen
+  Simulator::Schedule (Seconds (50.0), &DceUmipTestCase::StartPing, this);
 
 
   //
@@ -421,8 +527,29 @@ DceUmipTestCase::DoRun (void)
       Simulator::Stop (m_maxDuration);
     }
   Simulator::Run ();
+  if (m_debug)
+    {
+      probe->Print (std::cout);
+      OUTPUT ("Umip test " << m_testname << " home agent bindings: "
+                           << sampler->GetCacheSize (ha.Get (0)));
+    }
+  if (!m_pingStatus)
+    {
+      Mip6dHelper::DumpLogRings (std::cerr);
+    }
   Simulator::Destroy ();
 
+  // before any assertion, which may return
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  if (m_debug)
+    {
+      OUTPUT ("Umip test " << m_testname << " files kept in " << m_rootDir);
+    }
+  else
+    {
+      RemoveTree (m_rootDir);
+    }
+
 
   //
   // Step 5
@@ -430,28 +557,734 @@ DceUmipTestCase::DoRun (void)
   //
   NS_TEST_ASSERT_MSG_EQ (m_pingStatus, true, "Umip test " << m_testname
                                                           << " did not return successfully: " << g_testError);
+  // replies must keep coming during the grace window (1 s ping interval)
+  NS_TEST_ASSERT_MSG_EQ ((m_lastReply + Seconds (3) >= m_firstReply + m_grace), true,
+                         "Umip test " << m_testname << " lost connectivity after "
+                                      << (m_lastReply - m_firstReply).GetSeconds () << "s");
   if (m_debug)
     {
       OUTPUT ("Umip test " << m_testname
                            << " stack done. status = " << m_pingStatus);
 
     }
+}
 
-  // XXX: needs to remove files
-  if (m_debug)
+// CsmaNetDevice traces MacTx with the Ethernet header, and pads short
+// frames: the tap must hand over the bare IPv6 packet.
+class Mip6PacketTapTestCase : public TestCase
+{
+public:
+  Mip6PacketTapTestCase ();
+private:
+  virtual void DoRun (void);
+  void Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent);
+
+  uint32_t m_tapped;
+  uint32_t m_size;
+  bool m_parsed;
+  Mip6PacketInfo m_info;
+};
+
+Mip6PacketTapTestCase::Mip6PacketTapTestCase ()
+  : TestCase ("Tap of the packets a CSMA device sends"),
+    m_tapped (0),
+    m_size (0),
+    m_parsed (false)
+{
+}
+void
+Mip6PacketTapTestCase::Tap (Ptr<NetDevice> device, Ptr<const Packet> packet, bool sent)
+{
+  m_tapped++;
+  m_size = packet->GetSize ();
+  m_parsed = sent && Mip6PacketParser::Parse (packet, m_info);
+}
+void
+Mip6PacketTapTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  CsmaHelper csma;
+  NetDeviceContainer devices = csma.Install (nodes);
+  Mip6PacketTap::Install (nodes.Get (0), MakeCallback (&Mip6PacketTapTestCase::Tap, this),
+                          false, true);
+
+  // a header alone, shorter than the Ethernet minimum payload
+  Ipv6Header header;
+  header.SetSourceAddress (Ipv6Address ("2001:1:2:3::1"));
+  header.SetDestinationAddress (Ipv6Address ("2001:1:2:3::2"));
+  header.SetNextHeader (59);
+  header.SetPayloadLength (0);
+  header.SetHopLimit (64);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  devices.Get (0)->Send (packet, devices.Get (1)->GetAddress (), 0x86DD);
+  // not an IP packet: not tapped
+  devices.Get (0)->Send (Create<Packet> (64), devices.Get (1)->GetAddress (), 0x88B5);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_tapped, 1, "the IPv6 packet alone must be tapped");
+  NS_TEST_ASSERT_MSG_EQ (m_parsed, true, "the tapped packet must start with its IPv6 header");
+  NS_TEST_ASSERT_MSG_EQ (m_size, 40, "Ethernet header, padding and trailer must be stripped");
+  NS_TEST_ASSERT_MSG_EQ (m_info.destination, Ipv6Address ("2001:1:2:3::2"), "wrong destination");
+}
+
+// Identical configurations are written once, and each node's mip6d.conf
+// links to its copy; MNs differ by their home address.
+class Mip6dConfigSharingTestCase : public TestCase
+{
+public:
+  Mip6dConfigSharingTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6dConfigSharingTestCase::Mip6dConfigSharingTestCase ()
+  : TestCase ("Sharing of identical mip6d.conf")
+{
+}
+void
+Mip6dConfigSharingTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("sharing", cwd);
+
+  const uint32_t n = 4;
+  NodeContainer ha, mn;
+  ha.Create (n);
+  mn.Create (n);
+  Mip6dHelper mip6d;
+  mip6d.ShareIdenticalConfig (Mip6dHelper::CONFIG_SHARING_SYMLINK, "spool");
+  mip6d.EnableHA (ha);
+  for (uint32_t i = 0; i < n; i++)
     {
-      ::system (("/bin/mv -f files-0 files-0-" + m_testname).c_str ());
-      ::system (("/bin/mv -f files-1 files-1-" + m_testname).c_str ());
-      ::system (("/bin/mv -f files-2 files-2-" + m_testname).c_str ());
-      ::system (("/bin/mv -f files-3 files-3-" + m_testname).c_str ());
-      ::system (("/bin/mv -f files-5 files-5-" + m_testname).c_str ());
+      std::ostringstream hoa;
+      hoa << "2001:1:2:3::" << 1000 + i;
+      mip6d.AddHomeAgentAddress (mn.Get (i), Ipv6Address ("2001:1:2:3::1"));
+      mip6d.AddHomeAddress (mn.Get (i), Ipv6Address (hoa.str ().c_str ()), Ipv6Prefix (64));
+      mip6d.AddEgressInterface (mn.Get (i), "sim0");
     }
-  else
+  mip6d.Install (ha);
+  mip6d.Install (mn);
+
+  uint32_t unique = mip6d.GetUniqueConfigCount ();
+  int files = CountEntries ("spool/etc");
+  bool linked = true;
+  NodeContainer all (ha, mn);
+  for (uint32_t i = 0; i < all.GetN (); i++)
     {
-      ::system ("/bin/rm -rf files-*/usr/local/etc/*.pid");
-    } 
+      std::ostringstream conf;
+      conf << "files-" << all.Get (i)->GetId () << "/etc/mip6d.conf";
+      linked = linked && FileExists (conf.str ());
+    }
+  Simulator::Destroy ();
 
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
 
+  NS_TEST_ASSERT_MSG_EQ (unique, 1 + n, "one HA configuration and one per MN expected");
+  NS_TEST_ASSERT_MSG_EQ (files, (int)(1 + n), "one spool file per distinct configuration expected");
+  NS_TEST_ASSERT_MSG_EQ (linked, true, "every node must find its mip6d.conf");
+}
+
+// A range of PMIP profiles is expanded into one profile per MN, from the
+// base MAC and prefix up to the count-th.
+class Mip6dProfileRangeTestCase : public TestCase
+{
+public:
+  Mip6dProfileRangeTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6dProfileRangeTestCase::Mip6dProfileRangeTestCase ()
+  : TestCase ("Rendering of a range of PMIP MN profiles")
+{
+}
+void
+Mip6dProfileRangeTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("range", cwd);
+
+  const uint32_t count = 300;
+  Ptr<Node> mag = CreateObject<Node> ();
+  Mip6dHelper mip6d;
+  mip6d.EnableMAG (mag, "sim0", Ipv6Address ("2001:1:2:3::2"));
+  mip6d.AddMNProfileRangeMAG (mag, Mac48Address ("00:00:00:00:00:fe"), count,
+                              Ipv6Address ("2001:1:2:3::1"),
+                              Ipv6Address ("2001:1:10::"), Ipv6Prefix (64), 2);
+  mip6d.Install (NodeContainer (mag));
+
+  std::ostringstream path;
+  path << "files-" << mag->GetId () << "/etc/mip6d.conf";
+  std::string conf = ReadFile (path.str ());
+  Simulator::Destroy ();
+
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
+
+  // the MAC carries into the next byte, the prefix moves by stride
+  std::ostringstream first, last, past;
+  first << "MNIdentifier \"" << Mac48Address ("00:00:00:00:00:fe") << "\"";
+  last << "MNIdentifier \"" << Mac48Address ("00:00:00:00:02:29") << "\"";
+  past << "MNIdentifier \"" << Mac48Address ("00:00:00:00:02:2a") << "\"";
+  std::ostringstream firstPrefix, lastPrefix, pastPrefix;
+  firstPrefix << "HomeNetworkPrefix1 " << Ipv6Address ("2001:1:10::") << "/64;";
+  lastPrefix << "HomeNetworkPrefix1 " << Ipv6Address ("2001:1:10:256::") << "/64;";
+  pastPrefix << "HomeNetworkPrefix1 " << Ipv6Address ("2001:1:10:258::") << "/64;";
+  uint32_t profiles = 0;
+  for (std::string::size_type at = conf.find ("MNIdentifier"); at != std::string::npos;
+       at = conf.find ("MNIdentifier", at + 1))
+    {
+      profiles++;
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (profiles, count, "one profile per MN of the range expected");
+  NS_TEST_ASSERT_MSG_NE (conf.find (first.str ()), std::string::npos, "first MN missing");
+  NS_TEST_ASSERT_MSG_NE (conf.find (last.str ()), std::string::npos, "last MN missing");
+  NS_TEST_ASSERT_MSG_EQ (conf.find (past.str ()), std::string::npos, "MN past the range");
+  NS_TEST_ASSERT_MSG_NE (conf.find (firstPrefix.str ()), std::string::npos, "first prefix missing");
+  NS_TEST_ASSERT_MSG_NE (conf.find (lastPrefix.str ()), std::string::npos, "last prefix missing");
+  NS_TEST_ASSERT_MSG_EQ (conf.find (pastPrefix.str ()), std::string::npos, "prefix past the range");
+}
+
+// Rendering on a worker pool writes the same configurations, byte for
+// byte, as rendering serially.
+class Mip6dRenderThreadsTestCase : public TestCase
+{
+public:
+  Mip6dRenderThreadsTestCase ();
+private:
+  virtual void DoRun (void);
+  // install a fixed set of HAs, MAGs and MNs and read back their mip6d.conf
+  std::vector<std::string> Render (uint32_t threads);
+};
+
+Mip6dRenderThreadsTestCase::Mip6dRenderThreadsTestCase ()
+  : TestCase ("Parallel rendering of mip6d.conf")
+{
+}
+std::vector<std::string>
+Mip6dRenderThreadsTestCase::Render (uint32_t threads)
+{
+  const uint32_t n = 8;
+  NodeContainer ha, mag, mn;
+  ha.Create (2);
+  mag.Create (2);
+  mn.Create (n);
+  Mip6dHelper mip6d;
+  mip6d.SetRenderThreads (threads);
+  mip6d.EnableHA (ha);
+  for (uint32_t i = 0; i < mag.GetN (); i++)
+    {
+      std::ostringstream base;
+      base << "2001:1:" << 10 + i << "::";
+      mip6d.EnableMAG (mag.Get (i), "sim0", Ipv6Address ("2001:1:2:3::2"));
+      mip6d.AddMNProfileRangeMAG (mag.Get (i), Mac48Address ("00:00:00:00:01:00"), 50,
+                                  Ipv6Address ("2001:1:2:3::1"),
+                                  Ipv6Address (base.str ().c_str ()), Ipv6Prefix (64));
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      std::ostringstream hoa;
+      hoa << "2001:1:2:3::" << 1000 + i;
+      mip6d.AddHomeAgentAddress (mn.Get (i), Ipv6Address ("2001:1:2:3::1"));
+      mip6d.AddHomeAddress (mn.Get (i), Ipv6Address (hoa.str ().c_str ()), Ipv6Prefix (64));
+      mip6d.AddEgressInterface (mn.Get (i), "sim0");
+    }
+  NodeContainer all (ha, mag, mn);
+  mip6d.Install (all);
+
+  std::vector<std::string> confs;
+  for (uint32_t i = 0; i < all.GetN (); i++)
+    {
+      std::ostringstream path;
+      path << "files-" << all.Get (i)->GetId () << "/etc/mip6d.conf";
+      confs.push_back (ReadFile (path.str ()));
+    }
+  Simulator::Destroy ();
+  return confs;
+}
+void
+Mip6dRenderThreadsTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("threads", cwd);
+
+  // node ids restart from 0 after Simulator::Destroy (): the second
+  // install rewrites the files of the first
+  std::vector<std::string> serial = Render (1);
+  std::vector<std::string> parallel = Render (4);
+
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
+
+  NS_TEST_ASSERT_MSG_EQ (parallel.size (), serial.size (), "node count differs");
+  for (uint32_t i = 0; i < serial.size () && i < parallel.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (serial[i].empty (), false, "node " << i << " has no mip6d.conf");
+      bool same = parallel[i] == serial[i];
+      NS_TEST_ASSERT_MSG_EQ (same, true, "mip6d.conf of node " << i << " differs with 4 threads");
+    }
+}
+
+// A deferred configuration is written when its daemon starts, not at
+// install time.
+class Mip6dDeferredConfigTestCase : public TestCase
+{
+public:
+  Mip6dDeferredConfigTestCase ();
+private:
+  virtual void DoRun (void);
+  void Check (std::string path, bool *exists);
+};
+
+Mip6dDeferredConfigTestCase::Mip6dDeferredConfigTestCase ()
+  : TestCase ("Deferred generation of mip6d.conf")
+{
+}
+void
+Mip6dDeferredConfigTestCase::Check (std::string path, bool *exists)
+{
+  *exists = FileExists (path);
+}
+void
+Mip6dDeferredConfigTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("deferred", cwd);
+
+  Ptr<Node> mn = CreateObject<Node> ();
+  Mip6dHelper mip6d;
+  mip6d.DeferConfigGeneration ();
+  mip6d.SetStartPolicy (CreateObjectWithAttributes<Mip6dAllAtOnceStartPolicy>
+                          ("Start", TimeValue (Seconds (1.0))));
+  mip6d.AddHomeAgentAddress (mn, Ipv6Address ("2001:1:2:3::1"));
+  mip6d.AddHomeAddress (mn, Ipv6Address ("2001:1:2:3::1000"), Ipv6Prefix (64));
+  mip6d.AddEgressInterface (mn, "sim0");
+  mip6d.Install (NodeContainer (mn));
+
+  std::ostringstream path;
+  path << "files-" << mn->GetId () << "/etc/mip6d.conf";
+  bool atInstall = FileExists (path.str ());
+  bool beforeStart = true;
+  bool atStart = false;
+  Simulator::Schedule (Seconds (1.0) - NanoSeconds (1),
+                       &Mip6dDeferredConfigTestCase::Check, this, path.str (), &beforeStart);
+  // events of the same time run in the order they were scheduled: this
+  // check follows the rendering event of Install (), and the stop keeps
+  // the application, which would need DCE, from starting
+  Simulator::Schedule (Seconds (1.0),
+                       &Mip6dDeferredConfigTestCase::Check, this, path.str (), &atStart);
+  Simulator::Stop (Seconds (1.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
+
+  NS_TEST_ASSERT_MSG_EQ (atInstall, false, "mip6d.conf written at install time");
+  NS_TEST_ASSERT_MSG_EQ (beforeStart, false, "mip6d.conf written before the daemon starts");
+  NS_TEST_ASSERT_MSG_EQ (atStart, true, "mip6d.conf missing when the daemon starts");
+}
+
+// The configuration footprint follows what is stored: profiles and long
+// names count, a range does not grow with its size.
+class Mip6dConfigMemoryTestCase : public TestCase
+{
+public:
+  Mip6dConfigMemoryTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6dConfigMemoryTestCase::Mip6dConfigMemoryTestCase ()
+  : TestCase ("Memory usage of the mip6d configuration")
+{
+}
+void
+Mip6dConfigMemoryTestCase::DoRun (void)
+{
+  Ptr<Node> plain = CreateObject<Node> ();
+  Ptr<Node> mag = CreateObject<Node> ();
+  Ptr<Node> mn = CreateObject<Node> ();
+  Mip6dHelper mip6d;
+
+  uint32_t none = Mip6dHelper::GetConfigMemoryUsage (plain);
+
+  mip6d.EnableMAG (mag, "sim0", Ipv6Address ("2001:1:2:3::2"));
+  uint32_t empty = Mip6dHelper::GetConfigMemoryUsage (mag);
+  const uint32_t profiles = 100;
+  for (uint32_t i = 0; i < profiles; i++)
+    {
+      std::ostringstream pfx;
+      pfx << "2001:1:" << 10 + i << "::";
+      mip6d.AddMNProfileMAG (mag, Mac48Address::Allocate (), Ipv6Address ("2001:1:2:3::1"),
+                             Ipv6Address (pfx.str ().c_str ()), Ipv6Prefix (64));
+    }
+  uint32_t listed = Mip6dHelper::GetConfigMemoryUsage (mag);
+  mip6d.AddMNProfileRangeMAG (mag, Mac48Address ("00:00:00:01:00:00"), 100000,
+                              Ipv6Address ("2001:1:2:3::1"),
+                              Ipv6Address ("2001:2::"), Ipv6Prefix (64));
+  uint32_t ranged = Mip6dHelper::GetConfigMemoryUsage (mag);
+
+  mip6d.AddHomeAddress (mn, Ipv6Address ("2001:1:2:3::1000"), Ipv6Prefix (64));
+  uint32_t shortName = Mip6dHelper::GetConfigMemoryUsage (mn);
+  std::string longName (64, 'x');
+  mip6d.AddEgressInterface (mn, longName.c_str ());
+  uint32_t longNamed = Mip6dHelper::GetConfigMemoryUsage (mn);
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (none, 0, "a node without mip6d costs nothing");
+  NS_TEST_ASSERT_MSG_GT (empty, 0, "an enabled MAG has a configuration");
+  // each profile holds a MAC and more than two IPv6 addresses worth
+  NS_TEST_ASSERT_MSG_GT (listed - empty, profiles * (6 + 2 * 16),
+                         "listed profiles must be counted");
+  NS_TEST_ASSERT_MSG_LT (ranged - listed, 1024u, "a range must not grow with its count");
+  NS_TEST_ASSERT_MSG_GT (longNamed - shortName, longName.size (),
+                         "a heap allocated name must be counted");
+}
+
+// Drop every packet received within a time window.
+class Mip6OutageErrorModel : public ErrorModel
+{
+public:
+  Mip6OutageErrorModel (Time start, Time end)
+    : m_start (start),
+      m_end (end)
+  {
+  }
+private:
+  virtual bool DoCorrupt (Ptr<Packet> packet)
+  {
+    return Simulator::Now () >= m_start && Simulator::Now () < m_end;
+  }
+  virtual void DoReset (void)
+  {
+  }
+
+  Time m_start;
+  Time m_end;
+};
+
+// The goodput sink reports a pause longer than GapThreshold as one
+// interruption, with the records skipped over it as lost.
+class Mip6GoodputSinkTestCase : public TestCase
+{
+public:
+  Mip6GoodputSinkTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6GoodputSinkTestCase::Mip6GoodputSinkTestCase ()
+  : TestCase ("Interruptions seen by the goodput sink")
+{
+}
+void
+Mip6GoodputSinkTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  CsmaHelper csma;
+  NetDeviceContainer devices = csma.Install (nodes);
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  Ipv6AddressHelper address;
+  address.SetBase (Ipv6Address ("2001:1:2:3::"), Ipv6Prefix (64));
+  Ipv6InterfaceContainer interfaces = address.Assign (devices);
+
+  // one record every 10 ms from 3 s, once duplicate address detection
+  // is over; those sent in [5.005, 6.005) s, the 100 records from 5.01 s
+  // to 6.00 s, never arrive
+  devices.Get (1)->SetAttribute ("ReceiveErrorModel",
+                                 PointerValue (CreateObject<Mip6OutageErrorModel>
+                                                 (Seconds (5.005), Seconds (6.005))));
+  Ptr<Mip6GoodputSink> sink = CreateObject<Mip6GoodputSink> ();
+  sink->SetAttribute ("Local", AddressValue (Inet6SocketAddress (Ipv6Address::GetAny (), 9000)));
+  sink->SetAttribute ("GapThreshold", TimeValue (MilliSeconds (100)));
+  nodes.Get (1)->AddApplication (sink);
+  sink->SetStartTime (Seconds (1.0));
+  Ptr<Mip6GoodputSource> source = CreateObject<Mip6GoodputSource> ();
+  source->SetAttribute ("Remote", AddressValue (Inet6SocketAddress (interfaces.GetAddress (1, 1), 9000)));
+  source->SetAttribute ("Interval", TimeValue (MilliSeconds (10)));
+  nodes.Get (0)->AddApplication (source);
+  source->SetStartTime (Seconds (3.0));
+  source->SetStopTime (Seconds (8.0));
+  Simulator::Stop (Seconds (9.0));
+  Simulator::Run ();
+
+  std::vector<Mip6Interruption> interruptions = sink->GetInterruptions ();
+  uint32_t sent = source->GetNSent ();
+  uint32_t received = sink->GetNReceived ();
+  uint32_t lost = sink->GetNLost ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (interruptions.size (), 1, "one interruption expected");
+  NS_TEST_ASSERT_MSG_EQ (interruptions[0].lost, 100, "records sent during the outage are lost");
+  NS_TEST_ASSERT_MSG_EQ (interruptions[0].reordered, 0, "nothing comes out of order over UDP");
+  NS_TEST_ASSERT_MSG_EQ ((interruptions[0].recovery >= Seconds (0)), true,
+                         "the delay is back to normal after the outage");
+  NS_TEST_ASSERT_MSG_EQ (lost, 100, "only the outage loses records");
+  NS_TEST_ASSERT_MSG_EQ (received + lost, sent, "every record is received or lost");
+}
+
+// Each start policy hands out the start times it documents, and remembers
+// the latest one.
+class Mip6dStartPolicyTestCase : public TestCase
+{
+public:
+  Mip6dStartPolicyTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6dStartPolicyTestCase::Mip6dStartPolicyTestCase ()
+  : TestCase ("Start times of the mip6d start policies")
+{
+}
+void
+Mip6dStartPolicyTestCase::DoRun (void)
+{
+  const uint32_t n = 5;
+  NodeContainer nodes;
+  nodes.Create (n);
+
+  Ptr<Mip6dStartPolicy> linear = CreateObjectWithAttributes<Mip6dLinearStartPolicy>
+      ("Start", TimeValue (Seconds (2.0)), "Interval", TimeValue (MilliSeconds (500)));
+  Time linearLast = Seconds (0);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Time expected = Seconds (2.0) + MilliSeconds (500) * nodes.Get (i)->GetId ();
+      NS_TEST_ASSERT_MSG_EQ (linear->GetStartTime (nodes.Get (i)), expected,
+                             "linear start of node " << nodes.Get (i)->GetId ());
+      linearLast = std::max (linearLast, expected);
+    }
+  NS_TEST_ASSERT_MSG_EQ (linear->GetLastStartTime (), linearLast, "last linear start");
+  NS_TEST_ASSERT_MSG_EQ (linear->GetNStarted (), n, "linear start count");
+
+  // waves of 2: 1 s, 1 s, 4 s, 4 s, 7 s, in installation order
+  Ptr<Mip6dStartPolicy> batch = CreateObjectWithAttributes<Mip6dBatchStartPolicy>
+      ("Start", TimeValue (Seconds (1.0)), "WaveInterval", TimeValue (Seconds (3.0)),
+       "BatchSize", UintegerValue (2));
+  for (uint32_t i = 0; i < n; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (batch->GetStartTime (nodes.Get (n - 1 - i)),
+                             Seconds (1.0) + Seconds (3.0) * (i / 2),
+                             "batch start of the daemon installed " << i << "th");
+    }
+  NS_TEST_ASSERT_MSG_EQ (batch->GetLastStartTime (), Seconds (7.0), "last batch start");
+
+  Ptr<Mip6dJitterStartPolicy> jitter = CreateObjectWithAttributes<Mip6dJitterStartPolicy>
+      ("Start", TimeValue (Seconds (1.0)), "MaxJitter", TimeValue (MilliSeconds (500)));
+  jitter->AssignStreams (1);
+  Time first = jitter->GetStartTime (nodes.Get (0));
+  Time jitterLast = first;
+  bool spread = false;
+  for (uint32_t i = 1; i < 100; i++)
+    {
+      Time start = jitter->GetStartTime (nodes.Get (i % n));
+      NS_TEST_ASSERT_MSG_EQ ((start >= Seconds (1.0) && start < MilliSeconds (1500)), true,
+                             "jitter start " << start.GetSeconds () << "s out of [1, 1.5) s");
+      spread = spread || start != first;
+      jitterLast = std::max (jitterLast, start);
+    }
+  NS_TEST_ASSERT_MSG_EQ (spread, true, "jittered starts must differ");
+  NS_TEST_ASSERT_MSG_EQ (jitter->GetLastStartTime (), jitterLast, "last jittered start");
+
+  Ptr<Mip6dStartPolicy> once = CreateObjectWithAttributes<Mip6dAllAtOnceStartPolicy>
+      ("Start", TimeValue (Seconds (3.0)));
+  for (uint32_t i = 0; i < n; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (once->GetStartTime (nodes.Get (i)), Seconds (3.0),
+                             "all at once start of node " << nodes.Get (i)->GetId ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (once->GetLastStartTime (), Seconds (3.0), "last all at once start");
+  Simulator::Destroy ();
+}
+
+// With several home agents and mobile routers, every link gets its own
+// prefix and each mobile network is routed, by the other home agents,
+// through the home agent its router registers with.
+class MobilityTopologyAddressPlanTestCase : public TestCase
+{
+public:
+  MobilityTopologyAddressPlanTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+MobilityTopologyAddressPlanTestCase::MobilityTopologyAddressPlanTestCase ()
+  : TestCase ("Address plan of a multi-HA, multi-MR topology")
+{
+}
+void
+MobilityTopologyAddressPlanTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("plan", cwd);
+
+  const uint32_t nHa = 3, nAr = 2, nMn = 2, nMr = 4, nCn = 1;
+  MobilityTopologyHelper topology;
+  topology.SetHomeAgents (nHa);
+  topology.SetAccessRouters (nAr);
+  topology.SetMobileNodes (nMn);
+  topology.SetMobileRouters (nMr, 1);
+  topology.SetCorrespondentNodes (nCn);
+  topology.Create ();
+
+  // the /64 of every link
+  std::set<Ipv6Address> prefixes;
+  prefixes.insert (topology.GetHomePrefix ());
+  for (uint32_t i = 0; i < nAr; i++)
+    {
+      prefixes.insert (topology.GetAccessPrefix (i));
+    }
+  prefixes.insert (topology.GetCorrespondentAddress (0).CombinePrefix (Ipv6Prefix (64)));
+  for (uint32_t i = 0; i < nMr; i++)
+    {
+      prefixes.insert (topology.GetMobileNetworkPrefix (i));
+    }
+  // the addresses on the home link
+  std::set<Ipv6Address> homeLink;
+  bool onHomeLink = true;
+  for (uint32_t i = 0; i < nHa; i++)
+    {
+      homeLink.insert (topology.GetHomeAgentAddress (i));
+      onHomeLink = onHomeLink && topology.GetHomeAgentAddress (i).CombinePrefix (Ipv6Prefix (64))
+        == topology.GetHomePrefix ();
+    }
+  for (uint32_t i = 0; i < nMn + nMr; i++)
+    {
+      homeLink.insert (topology.GetHomeAddress (i));
+      onHomeLink = onHomeLink && topology.GetHomeAddress (i).CombinePrefix (Ipv6Prefix (64))
+        == topology.GetHomePrefix ();
+    }
+
+  // the routes the home agents get once mip6d runs, and the home agent
+  // each mobile router registers with
+  KernelConfigHelper tunnels = topology.GetTunnelConfig ();
+  std::vector<std::vector<std::string> > routes;
+  for (uint32_t i = 0; i < nHa; i++)
+    {
+      routes.push_back (tunnels.GetIpCommands (topology.GetHomeAgents ().Get (i)));
+    }
+  Mip6dHelper mip6d;
+  NodeContainer daemons = topology.ConfigureMip6d (mip6d);
+  mip6d.Install (daemons);
+  std::vector<std::string> confs;
+  for (uint32_t i = 0; i < nMr; i++)
+    {
+      std::ostringstream path;
+      path << "files-" << topology.GetMobileRouters ().Get (i)->GetId () << "/etc/mip6d.conf";
+      confs.push_back (ReadFile (path.str ()));
+    }
+  Simulator::Destroy ();
+
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
+
+  NS_TEST_ASSERT_MSG_EQ (prefixes.size (), 1 + nAr + 1 + nMr, "every link needs its own prefix");
+  NS_TEST_ASSERT_MSG_EQ (homeLink.size (), nHa + nMn + nMr,
+                         "home agent and home addresses must not collide");
+  NS_TEST_ASSERT_MSG_EQ (onHomeLink, true, "home agent and home addresses must be on the home link");
+
+  std::set<uint32_t> serving;
+  for (uint32_t j = 0; j < nMr; j++)
+    {
+      uint32_t servedBy = topology.GetServingHomeAgent (nMn + j);
+      NS_TEST_ASSERT_MSG_LT (servedBy, nHa, "MR " << j << " served by a missing home agent");
+      serving.insert (servedBy);
+
+      std::ostringstream ha;
+      ha << "HomeAgentAddress " << topology.GetHomeAgentAddress (servedBy) << ";";
+      NS_TEST_ASSERT_MSG_NE (confs[j].find (ha.str ()), std::string::npos,
+                             "MR " << j << " must register with home agent " << servedBy);
+
+      std::ostringstream route;
+      route << "route add " << topology.GetMobileNetworkPrefix (j) << "/64 via "
+            << topology.GetHomeAgentAddress (servedBy) << " dev sim0";
+      for (uint32_t i = 0; i < nHa; i++)
+        {
+          bool found = std::find (routes[i].begin (), routes[i].end (), route.str ())
+            != routes[i].end ();
+          NS_TEST_ASSERT_MSG_EQ (found, i != servedBy,
+                                 "route of MR " << j << "'s network on home agent " << i);
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (serving.size (), nHa, "the mobile routers must spread over the home agents");
+}
+
+// A home agent under synthetic load registers every virtual mobile node,
+// and the binding sampler mirrors its cache.
+class Mip6dBindingLoadTestCase : public TestCase
+{
+public:
+  Mip6dBindingLoadTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Mip6dBindingLoadTestCase::Mip6dBindingLoadTestCase ()
+  : TestCase ("Binding Update load on a home agent")
+{
+}
+void
+Mip6dBindingLoadTestCase::DoRun (void)
+{
+  std::string cwd;
+  std::string dir = EnterPrivateDirectory ("load", cwd);
+
+  const uint32_t n = 10;
+  NodeContainer ha, generator;
+  ha.Create (1);
+  generator.Create (1);
+  CsmaHelper csma;
+  csma.Install (ha);
+  csma.Install (NodeContainer (ha.Get (0), generator.Get (0)));
+
+  DceManagerHelper dceMng;
+  dceMng.SetTaskManagerAttribute ("FiberManagerType",
+                                  EnumValue (0));
+  dceMng.SetNetworkStack ("ns3::LinuxSocketFdFactory",
+                          "Library", StringValue ("liblinux.so"));
+  dceMng.Install (ha);
+
+  KernelConfigHelper kernel;
+  kernel.SetLinkUp (ha.Get (0), "lo");
+  kernel.AddAddress (ha.Get (0), "sim0", "2001:1:2:3::1/64");
+  kernel.SetLinkUp (ha.Get (0), "sim0");
+  kernel.AddAddress (ha.Get (0), "sim1", "2001:1:2:4::1/64");
+  kernel.SetLinkUp (ha.Get (0), "sim1");
+  kernel.Install (Seconds (0.1));
+
+  Mip6dHelper mip6d;
+  mip6d.EnableHA (ha);
+  Ptr<Mip6dBindingSampler> sampler = mip6d.EnableBindingSampler ();
+  mip6d.Install (ha);
+
+  Ptr<Mip6BindingUpdateGenerator> load = CreateObject<Mip6BindingUpdateGenerator> ();
+  load->SetAttribute ("HomeAgent", Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1")));
+  load->SetAttribute ("HomeAddressBase", Ipv6AddressValue (Ipv6Address ("2001:1:2:3::1:0")));
+  load->SetAttribute ("CareOfAddressBase", Ipv6AddressValue (Ipv6Address ("2001:1:2:4::1:0")));
+  load->SetAttribute ("NBindings", UintegerValue (n));
+  load->SetAttribute ("Rate", DoubleValue (10));
+  load->SetStartTime (Seconds (3.0));
+  generator.Get (0)->AddApplication (load);
+
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+  uint32_t registered = load->GetNRegistered ();
+  uint32_t cached = sampler->GetCacheSize (ha.Get (0));
+  Simulator::Destroy ();
+
+  NS_ABORT_MSG_IF (::chdir (cwd.c_str ()) != 0, "cannot go back to " << cwd);
+  RemoveTree (dir);
+
+  NS_TEST_ASSERT_MSG_EQ (registered, n, "every virtual mobile node must register");
+  NS_TEST_ASSERT_MSG_EQ (cached, n, "the sampled binding cache must hold every binding");
 }
 
 static class DceUmipTestSuite : public TestSuite
@@ -470,14 +1303,25 @@ DceUmipTestSuite::DceUmipTestSuite ()
   {
     const char *name;
     int duration;
+    int grace;
   } testPair;
 
   const testPair tests[] = {
-    { "MIP6", 300},
-    { "NEMO", 300},
+    { "MIP6", 300, 0},
+    // replies must keep coming for 5 s through the MR's tunnel
+    { "NEMO", 300, 5},
   };
 
-  ::system ("/bin/rm -rf files-*/usr/local/etc/*.pid");
+  AddTestCase (new Mip6PacketTapTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dConfigSharingTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dProfileRangeTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dRenderThreadsTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dDeferredConfigTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dConfigMemoryTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6GoodputSinkTestCase, TestCase::QUICK);
+  AddTestCase (new Mip6dStartPolicyTestCase, TestCase::QUICK);
+  AddTestCase (new MobilityTopologyAddressPlanTestCase, TestCase::QUICK);
+
   // for the moment: not supported quagga for freebsd
   std::string filePath = SearchExecFile ("DCE_PATH", "liblinux.so", 0);
   for (unsigned int i = 0; i < sizeof(tests) / sizeof(testPair); i++)
@@ -487,9 +1331,14 @@ DceUmipTestSuite::DceUmipTestSuite ()
           continue;
         }
       AddTestCase (new DceUmipTestCase (std::string (tests[i].name),
-                                        Seconds (tests[i].duration)),
+                                        Seconds (tests[i].duration),
+                                        Seconds (tests[i].grace)),
                    TestCase::QUICK);
     }
+  if (filePath.length () > 0)
+    {
+      AddTestCase (new Mip6dBindingLoadTestCase, TestCase::QUICK);
+    }
 }
 
 } // namespace ns3